@@ -0,0 +1,201 @@
+#include "actorpp/actor.hpp"
+#include "bench.hpp"
+#include <memory>
+#include <vector>
+
+using namespace actorpp;
+using bench::Clock;
+using bench::elapsed_ns;
+
+class PingPong : public Actor {
+public:
+  PingPong(Channel<int> pong) : ping(*this), do_exit(*this), pong(pong) {}
+  Channel<int> ping;
+
+  void run() {
+    while (true) {
+      switch (wait(ping, do_exit)) {
+      case 0:
+        pong.push(ping.pop());
+        break;
+      case 1:
+        if (do_exit.pop())
+          return;
+        break;
+      }
+    }
+  }
+  void exit() { do_exit.push(true); }
+
+private:
+  Channel<bool> do_exit;
+  Channel<int> pong;
+};
+
+/// pushes n values to out as fast as possible
+class Producer : public Actor {
+public:
+  Producer(Channel<int> out, size_t n) : out(out), n(n) {}
+
+  void run() {
+    for (size_t i = 0; i < n; i++)
+      out.push(i);
+  }
+  void exit() {}
+
+private:
+  Channel<int> out;
+  size_t n;
+};
+
+class Nothing : public Actor {
+public:
+  void run() {}
+  void exit() {}
+};
+
+/// round trip time through an actor on another thread
+static bench::Result ping_pong(const bench::Options &options) {
+  bench::Result result;
+  result.name = "ping_pong";
+
+  Actor self;
+  Channel<int> pong(self);
+  ActorThread<PingPong> pp(pong);
+
+  size_t warmup = options.iterations(10000);
+  size_t n = options.iterations(100000);
+  for (size_t i = 0; i < warmup + n; i++) {
+    Clock::time_point start = Clock::now();
+    pp.ping.push(i);
+    self.wait(pong);
+    pong.pop();
+    Clock::time_point end = Clock::now();
+
+    if (i >= warmup)
+      result.sample_ns.push_back(elapsed_ns(start, end));
+  }
+
+  return result;
+}
+
+/// time to receive items_per_producer items from each of n_producers threads
+/// pushing to the same channel; each sample is one run
+static bench::Result fan_in(const bench::Options &options,
+                            size_t n_producers) {
+  bench::Result result;
+  result.name = "fan_in";
+  result.params["producers"] = std::to_string(n_producers);
+
+  size_t items_per_producer = options.iterations(100000);
+  result.items_per_sample = n_producers * items_per_producer;
+
+  for (size_t run = 0; run < 20; run++) {
+    Actor self;
+    Channel<int> in(self);
+
+    Clock::time_point start = Clock::now();
+    {
+      std::vector<std::unique_ptr<ActorThread<Producer>>> producers;
+      for (size_t i = 0; i < n_producers; i++)
+        producers.emplace_back(
+            new ActorThread<Producer>(in, items_per_producer));
+
+      for (size_t i = 0; i < result.items_per_sample; i++) {
+        self.wait(in);
+        in.pop();
+      }
+    }
+    result.sample_ns.push_back(elapsed_ns(start, Clock::now()));
+  }
+
+  return result;
+}
+
+template <size_t... I> struct Indices {};
+template <size_t N, size_t... I>
+struct MakeIndices : MakeIndices<N - 1, N - 1, I...> {};
+template <size_t... I> struct MakeIndices<0, I...> : Indices<I...> {};
+
+template <size_t... I>
+static int wait_all(Actor &self, std::vector<Channel<int>> &channels,
+                    Indices<I...>) {
+  return self.wait(channels[I]...);
+}
+
+/// cost of wait over k channels when the last one is readable, so that all
+/// are checked
+template <size_t K>
+static bench::Result wait_k(const bench::Options &options) {
+  bench::Result result;
+  result.name = "wait";
+  result.params["channels"] = std::to_string(K);
+  result.ops_per_sample = 1000;
+
+  Actor self;
+  std::vector<Channel<int>> channels;
+  for (size_t i = 0; i < K; i++)
+    channels.emplace_back(self);
+
+  for (size_t sample = 0; sample < options.iterations(10000); sample++) {
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < result.ops_per_sample; i++) {
+      channels[K - 1].push(i);
+      wait_all(self, channels, MakeIndices<K>());
+      channels[K - 1].pop();
+    }
+    result.sample_ns.push_back(elapsed_ns(start, Clock::now()));
+  }
+
+  return result;
+}
+
+/// cost of constructing and destroying a channel associated with an actor
+static bench::Result channel_construction(const bench::Options &options) {
+  bench::Result result;
+  result.name = "channel_construction";
+  result.ops_per_sample = 1000;
+
+  Actor self;
+  for (size_t sample = 0; sample < options.iterations(10000); sample++) {
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < result.ops_per_sample; i++)
+      Channel<int> channel(self);
+    result.sample_ns.push_back(elapsed_ns(start, Clock::now()));
+  }
+
+  return result;
+}
+
+/// time to start and join an ActorThread which exits immediately
+static bench::Result spawn_join(const bench::Options &options) {
+  bench::Result result;
+  result.name = "spawn_join";
+
+  for (size_t i = 0; i < options.iterations(10000); i++) {
+    Clock::time_point start = Clock::now();
+    { ActorThread<Nothing> thread; }
+    result.sample_ns.push_back(elapsed_ns(start, Clock::now()));
+  }
+
+  return result;
+}
+
+int main(int argc, char **argv) {
+  bench::Options options(argc, argv);
+  bench::Report report;
+
+  report.add(ping_pong(options));
+  for (size_t n_producers : {1, 2, 4, 8})
+    report.add(fan_in(options, n_producers));
+  report.add(wait_k<1>(options));
+  report.add(wait_k<2>(options));
+  report.add(wait_k<4>(options));
+  report.add(wait_k<8>(options));
+  report.add(wait_k<16>(options));
+  report.add(channel_construction(options));
+  report.add(spawn_join(options));
+
+  options.finish(report);
+  return 0;
+}
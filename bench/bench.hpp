@@ -0,0 +1,209 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <regex>
+#include <sstream>
+#include <stdio.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+using Clock = std::chrono::steady_clock;
+
+inline double elapsed_ns(Clock::time_point start, Clock::time_point end) {
+  return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+/// the result of one benchmark: a set of samples, each the time taken for
+/// ops_per_sample operations, and optionally the number of items processed
+/// per sample for throughput
+struct Result {
+  std::string name;
+  std::map<std::string, std::string> params;
+  std::vector<double> sample_ns;
+  size_t ops_per_sample = 1;
+  size_t items_per_sample = 0;
+  /// other measurements, such as rates which can't be derived from samples
+  std::map<std::string, double> metrics;
+
+  /// the time per operation at percentile p (0-100), by nearest rank
+  double percentile(double p) const {
+    std::vector<double> sorted = per_op_ns();
+    std::sort(sorted.begin(), sorted.end());
+    if (sorted.empty())
+      return 0;
+    size_t rank = (size_t)(p / 100.0 * sorted.size() + 0.5);
+    return sorted[std::min(std::max(rank, (size_t)1), sorted.size()) - 1];
+  }
+
+  double mean() const {
+    std::vector<double> ns = per_op_ns();
+    double total = 0;
+    for (double x : ns)
+      total += x;
+    return ns.empty() ? 0 : total / ns.size();
+  }
+
+  /// items per second over all samples
+  double items_per_second() const {
+    double total = 0;
+    for (double x : sample_ns)
+      total += x;
+    return total ? items_per_sample * sample_ns.size() / (total * 1e-9) : 0;
+  }
+
+  std::vector<double> per_op_ns() const {
+    std::vector<double> ns;
+    for (double x : sample_ns)
+      ns.push_back(x / ops_per_sample);
+    return ns;
+  }
+};
+
+/// is s a number in JSON syntax, so that it can be written without quotes?
+inline bool is_number(const std::string &s) {
+  static const std::regex number("-?(0|[1-9][0-9]*)(\\.[0-9]+)?"
+                                 "([eE][+-]?[0-9]+)?");
+  return std::regex_match(s, number);
+}
+
+/// write s as a JSON string, escaping quotes, backslashes and control
+/// characters
+inline void write_json_string(std::ostream &out, const std::string &s) {
+  out << '"';
+  for (char c : s) {
+    if (c == '"' || c == '\\')
+      out << '\\' << c;
+    else if ((unsigned char)c < 0x20) {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      out << escaped;
+    } else
+      out << c;
+  }
+  out << '"';
+}
+
+/// write a JSON number; infinities and NaN can't be represented, so are
+/// written as null
+inline void write_json_number(std::ostream &out, double value) {
+  if (std::isfinite(value))
+    out << value;
+  else
+    out << "null";
+}
+
+/// collects results, prints a summary of each, and writes them all as JSON
+class Report {
+public:
+  void add(Result result) {
+    print(result);
+    results.push_back(std::move(result));
+  }
+
+  void write_json(std::ostream &out) const {
+    out << "{\n  \"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+      const Result &r = results[i];
+      out << (i ? "," : "") << "\n    {\"name\": ";
+      write_json_string(out, r.name);
+      for (auto &param : r.params) {
+        out << ", ";
+        write_json_string(out, param.first);
+        out << ": ";
+        if (is_number(param.second))
+          out << param.second;
+        else
+          write_json_string(out, param.second);
+      }
+      out << ", \"unit\": \"ns\", \"samples\": " << r.sample_ns.size()
+          << ", \"ops_per_sample\": " << r.ops_per_sample;
+      std::pair<const char *, double> stats[] = {
+          {"mean", r.mean()},
+          {"min", r.percentile(0)},
+          {"p50", r.percentile(50)},
+          {"p90", r.percentile(90)},
+          {"p99", r.percentile(99)},
+          {"p999", r.percentile(99.9)},
+          {"max", r.percentile(100)}};
+      for (auto &stat : stats) {
+        out << ", \"" << stat.first << "\": ";
+        write_json_number(out, stat.second);
+      }
+      if (r.items_per_sample) {
+        out << ", \"items_per_second\": ";
+        write_json_number(out, r.items_per_second());
+      }
+      for (auto &metric : r.metrics) {
+        out << ", ";
+        write_json_string(out, metric.first);
+        out << ": ";
+        write_json_number(out, metric.second);
+      }
+      out << "}";
+    }
+    out << "\n  ]\n}\n";
+  }
+
+private:
+  static void print(const Result &r) {
+    std::ostringstream name;
+    name << r.name;
+    for (auto &param : r.params)
+      name << " " << param.first << "=" << param.second;
+
+    std::cout << name.str() << ": p50 " << r.percentile(50) << " ns, p99 "
+              << r.percentile(99) << " ns, p99.9 " << r.percentile(99.9)
+              << " ns";
+    if (r.items_per_sample)
+      std::cout << ", " << r.items_per_second() << " items/s";
+    for (auto &metric : r.metrics)
+      std::cout << ", " << metric.first << " " << metric.second;
+    std::cout << std::endl;
+  }
+
+  std::vector<Result> results;
+};
+
+/// command line options shared by all benchmarks
+struct Options {
+  /// write JSON here if not empty
+  std::string json_path;
+  /// divide iteration counts by this, for quick runs
+  size_t scale_down = 1;
+
+  Options(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+      std::string arg = argv[i];
+      if (arg == "--json" && i + 1 < argc)
+        json_path = argv[++i];
+      else if (arg == "--quick")
+        scale_down = 100;
+      else
+        throw std::runtime_error("usage: " + std::string(argv[0]) +
+                                 " [--json path] [--quick]");
+    }
+  }
+
+  size_t iterations(size_t n) const {
+    return std::max<size_t>(n / scale_down, 1);
+  }
+
+  void finish(const Report &report) const {
+    if (json_path.empty())
+      return;
+    std::ofstream out(json_path);
+    report.write_json(out);
+    if (!out)
+      throw std::runtime_error("failed to write " + json_path);
+  }
+};
+
+} // namespace bench
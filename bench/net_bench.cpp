@@ -0,0 +1,234 @@
+// loopback throughput and latency through RecvThreadBase; this is built once
+// for each receive backend
+
+#include "actorpp/actor.hpp"
+#include "actorpp/buffer.hpp"
+#include "actorpp/net.hpp"
+#include "bench.hpp"
+#include <memory>
+#include <vector>
+
+using namespace actorpp;
+using bench::Clock;
+using bench::elapsed_ns;
+
+#if defined(ACTORPP_RECV_THREAD_SHUTDOWN)
+static const char *backend = "shutdown";
+#elif defined(ACTORPP_RECV_THREAD_EVENTFD)
+static const char *backend = "eventfd";
+#else
+static const char *backend = "pipe";
+#endif
+
+/// one connection to the server: receives data with a BufferRecvThread, and
+/// either sends it back (echo) or counts it (sink), pushing the number of
+/// bytes received to on_done when the client closes the connection
+class ServerConnection : public Actor {
+public:
+  ServerConnection(int fd, bool echo, const SocketOptions &options,
+                   Channel<size_t> on_done)
+      : data(*this), closed(*this), do_exit(*this), fd(fd), echo(echo),
+        on_done(on_done),
+        recv(new ActorThread<BufferRecvThread>(fd, data, closed, options)) {}
+
+  ~ServerConnection() {
+    recv.reset();
+    close(fd);
+  }
+
+  void run() {
+    size_t received = 0;
+    while (true) {
+      switch (wait(data, closed, do_exit)) {
+      case 0: {
+        Buffer buffer = data.pop();
+        received += buffer.size();
+        if (echo)
+          send_all(fd, BufferChain(buffer));
+      } break;
+      case 1:
+        closed.pop();
+        on_done.push(received);
+        return;
+      case 2:
+        if (do_exit.pop())
+          return;
+        break;
+      }
+    }
+  }
+
+  void exit() { do_exit.push(true); }
+
+private:
+  Channel<Buffer> data;
+  Channel<CloseReason> closed;
+  Channel<bool> do_exit;
+  int fd;
+  bool echo;
+  Channel<size_t> on_done;
+  std::unique_ptr<ActorThread<BufferRecvThread>> recv;
+};
+
+/// accepts connections on a local port, starting a ServerConnection for each
+class Server : public Actor {
+public:
+  Server(bool echo, const SocketOptions &options, Channel<size_t> on_done)
+      : listen_fd(listen("localhost", 0, 128)), echo(echo), options(options),
+        on_done(on_done) {}
+
+  ~Server() {
+    connections.clear();
+    close(listen_fd);
+  }
+
+  int port() const { return local_port(listen_fd); }
+
+  void run() {
+    while (true) {
+      int fd;
+      try {
+        fd = accept(listen_fd);
+      } catch (const std::runtime_error &) {
+        return;
+      }
+      connections.emplace_back(new ActorThread<ServerConnection>(
+          fd, echo, options, on_done));
+    }
+  }
+
+  // wakes accept
+  void exit() { shutdown(listen_fd, SHUT_RDWR); }
+
+private:
+  int listen_fd;
+  bool echo;
+  SocketOptions options;
+  Channel<size_t> on_done;
+  std::vector<std::unique_ptr<ActorThread<ServerConnection>>> connections;
+};
+
+/// sends n_messages messages of message_size bytes on one connection. In echo
+/// mode, each message is sent once the previous one has come back, and the
+/// round trip times are pushed to on_done; otherwise messages are sent back
+/// to back and the connection is shut down.
+class Client : public Actor {
+public:
+  Client(int port, bool echo, const SocketOptions &options,
+         size_t message_size, size_t n_messages,
+         Channel<std::vector<double>> on_done)
+      : data(*this), closed(*this), fd(connect("localhost", port, options)),
+        echo(echo), message_size(message_size), n_messages(n_messages),
+        on_done(on_done),
+        recv(new ActorThread<BufferRecvThread>(fd, data, closed, options)) {}
+
+  ~Client() {
+    recv.reset();
+    close(fd);
+  }
+
+  void run() {
+    BufferChain message(Buffer(std::vector<uint8_t>(message_size, 'x')));
+    std::vector<double> rtt_ns;
+    rtt_ns.reserve(echo ? n_messages : 0);
+
+    for (size_t i = 0; i < n_messages; i++) {
+      Clock::time_point start = Clock::now();
+      send_all(fd, message);
+      if (!echo)
+        continue;
+
+      size_t received = 0;
+      while (received < message_size && wait(data, closed) == 0)
+        received += data.pop().size();
+      if (received < message_size)
+        break; // closed by the server
+      rtt_ns.push_back(elapsed_ns(start, Clock::now()));
+    }
+
+    shutdown(fd, SHUT_WR);
+    on_done.push(std::move(rtt_ns));
+  }
+
+  void exit() {}
+
+private:
+  Channel<Buffer> data;
+  Channel<CloseReason> closed;
+  int fd;
+  bool echo;
+  size_t message_size;
+  size_t n_messages;
+  Channel<std::vector<double>> on_done;
+  std::unique_ptr<ActorThread<BufferRecvThread>> recv;
+};
+
+static bench::Result run(bool echo, size_t message_size,
+                         size_t n_connections, size_t messages_per_connection) {
+  bench::Result result;
+  result.name = echo ? "echo" : "sink";
+  result.params["backend"] = backend;
+  result.params["message_size"] = std::to_string(message_size);
+  result.params["connections"] = std::to_string(n_connections);
+
+  SocketOptions options =
+      echo ? SocketOptions::low_latency() : SocketOptions::bulk_throughput();
+
+  Actor self;
+  Channel<size_t> server_done(self);
+  Channel<std::vector<double>> client_done(self);
+  ActorThread<Server> server(echo, options, server_done);
+
+  Clock::time_point start = Clock::now();
+  {
+    std::vector<std::unique_ptr<ActorThread<Client>>> clients;
+    for (size_t i = 0; i < n_connections; i++)
+      clients.emplace_back(new ActorThread<Client>(
+          server.port(), echo, options, message_size, messages_per_connection,
+          client_done));
+
+    for (size_t i = 0; i < n_connections; i++) {
+      self.wait(client_done);
+      std::vector<double> rtt_ns = client_done.pop();
+      result.sample_ns.insert(result.sample_ns.end(), rtt_ns.begin(),
+                              rtt_ns.end());
+    }
+
+    // wait for the server to see everything
+    for (size_t i = 0; i < n_connections; i++) {
+      self.wait(server_done);
+      server_done.pop();
+    }
+  }
+  double seconds = elapsed_ns(start, Clock::now()) * 1e-9;
+
+  // in sink mode the only sample is the whole run
+  if (!echo)
+    result.sample_ns.push_back(seconds * 1e9);
+
+  double messages = n_connections * messages_per_connection;
+  result.metrics["messages_per_second"] = messages / seconds;
+  result.metrics["mb_per_second"] = messages * message_size / seconds / 1e6;
+  return result;
+}
+
+int main(int argc, char **argv) {
+  bench::Options options(argc, argv);
+  bench::Report report;
+
+  for (size_t message_size : {64, 1024, 16384, 262144})
+    for (size_t n_connections : {1, 4, 16}) {
+      // keep the amount of data per run roughly constant
+      size_t echo_messages = options.iterations(std::max<size_t>(
+          20000 / n_connections * 1024 / std::max<size_t>(message_size, 1024),
+          100));
+      report.add(run(true, message_size, n_connections, echo_messages));
+
+      size_t sink_messages = options.iterations(std::min<size_t>(
+          (size_t(64) << 20) / message_size / n_connections, 200000));
+      report.add(run(false, message_size, n_connections, sink_messages));
+    }
+
+  options.finish(report);
+  return 0;
+}
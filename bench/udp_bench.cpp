@@ -0,0 +1,112 @@
+// loopback datagram throughput through DatagramRecvThread, with a consumer
+// which either drops each batch straight away, or holds on to recent batches
+// so that the reader can't reuse their memory
+
+#include "actorpp/actor.hpp"
+#include "actorpp/net.hpp"
+#include "actorpp/udp.hpp"
+#include "bench.hpp"
+#include <deque>
+#include <vector>
+
+using namespace actorpp;
+using namespace std::chrono_literals;
+using bench::Clock;
+using bench::elapsed_ns;
+
+/// the most datagrams which may be sent but not received, so that the socket
+/// buffer doesn't overflow
+static const size_t window = 64;
+/// datagrams per sendmmsg call
+static const size_t burst = 16;
+
+/// sends n_datagrams datagrams of datagram_size bytes to dest, keeping at most
+/// window of them outstanding; received counts are pushed to acks
+class Sender : public Actor {
+public:
+  Sender(Address dest, size_t datagram_size, size_t n_datagrams)
+      : acks(*this), fd(bind_udp("localhost", 0)),
+        datagrams(burst,
+                  Datagram{dest, Buffer(std::vector<uint8_t>(datagram_size,
+                                                             'x'))}),
+        n_datagrams(n_datagrams) {}
+
+  ~Sender() { close(fd); }
+
+  Channel<size_t> acks;
+
+  void run() {
+    size_t sent = 0, acked = 0;
+    while (sent < n_datagrams) {
+      while (sent - acked + burst > window) {
+        // anything not received by now has been dropped
+        if (wait_for(100ms, acks) == -1)
+          acked = sent;
+        else
+          acked = std::max(acked, acks.pop());
+      }
+
+      size_t n = std::min(burst, n_datagrams - sent);
+      datagrams.resize(n);
+      send_datagrams(fd, datagrams);
+      sent += n;
+    }
+  }
+
+  void exit() {}
+
+private:
+  int fd;
+  std::vector<Datagram> datagrams;
+  size_t n_datagrams;
+};
+
+static bench::Result run(size_t datagram_size, size_t held_batches,
+                         size_t n_datagrams) {
+  bench::Result result;
+  result.name = "udp_recv";
+  result.params["datagram_size"] = std::to_string(datagram_size);
+  result.params["held_batches"] = std::to_string(held_batches);
+
+  int recv_fd = bind_udp("localhost", 0);
+  Address dest = resolve("localhost", local_port(recv_fd), SOCK_DGRAM)[0];
+
+  Actor self;
+  Channel<std::vector<Datagram>> on_message(self);
+  Channel<CloseReason> on_close(self);
+  size_t received = 0;
+  Clock::time_point start = Clock::now(), end = start;
+  {
+    ActorThread<DatagramRecvThread> recv(recv_fd, on_message, on_close);
+    ActorThread<Sender> sender(dest, datagram_size, n_datagrams);
+
+    std::deque<std::vector<Datagram>> held;
+    while (received < n_datagrams && self.wait_for(200ms, on_message) == 0) {
+      held.push_back(on_message.pop());
+      received += held.back().size();
+      end = Clock::now();
+      sender.acks.push(received);
+      if (held.size() > held_batches)
+        held.pop_front();
+    }
+  }
+  close(recv_fd);
+
+  result.sample_ns.push_back(elapsed_ns(start, end));
+  result.items_per_sample = received;
+  result.metrics["lost"] = n_datagrams - received;
+  return result;
+}
+
+int main(int argc, char **argv) {
+  bench::Options options(argc, argv);
+  bench::Report report;
+
+  for (size_t datagram_size : {64, 512, 1400})
+    for (size_t held_batches : {0, 8})
+      report.add(
+          run(datagram_size, held_batches, options.iterations(200000)));
+
+  options.finish(report);
+  return 0;
+}
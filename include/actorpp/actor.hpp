@@ -1,24 +1,40 @@
 #pragma once
 #include <condition_variable>
+#include <memory>
 #include <mutex>
 #include <queue>
 #include <stdexcept>
+#include <string>
 #include <thread>
 
+#include "config.hpp"
+
+#if defined(ACTORPP_CHANNEL_STATS) || defined(ACTORPP_ACTOR_STATS) ||          \
+    defined(ACTORPP_LOCK_STATS) || defined(ACTORPP_USDT)
+#include "stats.hpp"
+#endif
+
+#include "probes.hpp"
+
+#ifdef ACTORPP_TRACE
+#include "trace.hpp"
+#endif
+
 namespace actorpp {
+inline namespace ACTORPP_CONFIG_NAMESPACE {
 
 template <typename T> class Channel;
 
 namespace detail {
-template <typename T> int readable_channel(int i, Channel<T> &c) {
+template <typename C> int readable_channel(int i, C &c) {
   if (c.readable_with_lock())
     return i;
   else
     return -1;
 }
 
-template <typename T, typename... Ttail>
-int readable_channel(int i, Channel<T> &c, Channel<Ttail> &...chans) {
+template <typename C, typename... Ctail>
+int readable_channel(int i, C &c, Ctail &...chans) {
   if (c.readable_with_lock())
     return i;
   else
@@ -26,88 +42,212 @@ int readable_channel(int i, Channel<T> &c, Channel<Ttail> &...chans) {
 }
 
 struct ActorImpl {
-  std::mutex mut;
-  std::condition_variable cv;
-
-  template <typename... T> int wait(Channel<T> &...c) {
-    std::unique_lock<std::mutex> lock(mut);
+#ifdef ACTORPP_LOCK_STATS
+  typedef ProfiledMutex Mutex;
+  /// condition_variable only works with std::mutex
+  typedef std::condition_variable_any ConditionVariable;
+#else
+  typedef std::mutex Mutex;
+  typedef std::condition_variable ConditionVariable;
+#endif
+  typedef std::unique_lock<Mutex> Lock;
+
+  Mutex mut;
+  ConditionVariable cv;
+
+#ifdef ACTORPP_ACTOR_STATS
+  ActorStatsEntry stats;
+#endif
+
+  /// counts the time for which it exists as blocked
+  struct WaitTimer {
+#if defined(ACTORPP_ACTOR_STATS) || defined(ACTORPP_TRACE)
+    explicit WaitTimer(ActorImpl &impl) : impl(impl), start(now_ns()) {
+#ifdef ACTORPP_ACTOR_STATS
+      impl.stats.on_wait_start();
+#endif
+    }
+    ~WaitTimer() {
+      uint64_t end = now_ns();
+#ifdef ACTORPP_ACTOR_STATS
+      impl.stats.on_wait(start, end);
+#endif
+#ifdef ACTORPP_TRACE
+      trace_span("wait", start, end);
+#endif
+    }
+
+    ActorImpl &impl;
+    uint64_t start;
+#else
+    explicit WaitTimer(ActorImpl &) {}
+#endif
+  };
+
+  template <typename... C> int wait(C &...c) {
+    ACTORPP_PROBE1(wait_enter, this);
+    WaitTimer timer(*this);
+    Lock lock(mut);
     int i;
     cv.wait(lock,
             [&]() { return (i = detail::readable_channel(0, c...)) != -1; });
+    ACTORPP_PROBE2(wait_exit, this, i);
     return i;
   }
 
-  template <class Clock, class Duration, typename... T>
+  template <class Clock, class Duration, typename... C>
   int wait_until(const std::chrono::time_point<Clock, Duration> &timeout_time,
-                 Channel<T> &...c) {
-    std::unique_lock<std::mutex> lock(mut);
+                 C &...c) {
+    ACTORPP_PROBE1(wait_enter, this);
+    WaitTimer timer(*this);
+    Lock lock(mut);
     int i;
     cv.wait_until(lock, timeout_time, [&]() {
       return (i = detail::readable_channel(0, c...)) != -1;
     });
+    ACTORPP_PROBE2(wait_exit, this, i);
     return i;
   }
 
-  template <class Rep, class Period, typename... T>
-  int wait_for(const std::chrono::duration<Rep, Period> &rel_time,
-               Channel<T> &...c) {
-    std::unique_lock<std::mutex> lock(mut);
+  template <class Rep, class Period, typename... C>
+  int wait_for(const std::chrono::duration<Rep, Period> &rel_time, C &...c) {
+    ACTORPP_PROBE1(wait_enter, this);
+    WaitTimer timer(*this);
+    Lock lock(mut);
     int i;
     cv.wait_for(lock, rel_time, [&]() {
       return (i = detail::readable_channel(0, c...)) != -1;
     });
+    ACTORPP_PROBE2(wait_exit, this, i);
     return i;
   }
 };
 
 template <typename T> struct ChannelImpl {
   ChannelImpl(std::shared_ptr<ActorImpl> actor_impl)
-      : actor_impl(std::move(actor_impl)) {}
+      : actor_impl(std::move(actor_impl))
+#if defined(ACTORPP_CHANNEL_STATS) && defined(ACTORPP_ACTOR_STATS)
+        ,
+        stats(&this->actor_impl->stats)
+#endif
+  {
+  }
   std::shared_ptr<detail::ActorImpl> actor_impl;
   std::queue<T> elements;
 
+#ifdef ACTORPP_CHANNEL_STATS
+  ChannelStatsEntry stats;
+#endif
+#ifdef ACTORPP_CHANNEL_PUSH_TIMES
+  /// the time each element in elements was pushed
+  std::queue<uint64_t> push_times;
+#endif
+#ifdef ACTORPP_TRACE
+  /// the trace flow ID of each element in elements
+  std::queue<uint64_t> flows;
+#endif
+
+  void pushed_with_lock() {
+    ACTORPP_PROBE3(push, this, elements.size(),
+                   message_bytes(elements.back()));
+#ifdef ACTORPP_CHANNEL_STATS
+    stats.on_push(elements.size(), message_bytes(elements.back()));
+#endif
+#ifdef ACTORPP_CHANNEL_PUSH_TIMES
+    push_times.push(now_ns());
+    if (push_times.size() == 1)
+      stats.set_head(push_times.front());
+#endif
+#ifdef ACTORPP_TRACE
+    flows.push(trace_push(this));
+#endif
+  }
+
+  void popping_with_lock() {
+    ACTORPP_PROBE3(pop, this, elements.size() - 1,
+                   message_bytes(elements.front()));
+#ifdef ACTORPP_CHANNEL_STATS
+    stats.on_pop(message_bytes(elements.front()));
+#endif
+#ifdef ACTORPP_CHANNEL_PUSH_TIMES
+#ifdef ACTORPP_CHANNEL_LATENCY
+    stats.on_sojourn(now_ns() - push_times.front());
+#endif
+    push_times.pop();
+    stats.set_head(push_times.empty() ? 0 : push_times.front());
+#endif
+#ifdef ACTORPP_TRACE
+    trace_pop(this, flows.front());
+    flows.pop();
+#endif
+  }
+
   void push(const T &item) {
-    std::unique_lock<std::mutex> lock(actor_impl->mut);
+    ActorImpl::Lock lock(actor_impl->mut);
     elements.push(item);
+    pushed_with_lock();
     actor_impl->cv.notify_one();
   }
 
   void push(T &&item) {
-    std::unique_lock<std::mutex> lock(actor_impl->mut);
+    ActorImpl::Lock lock(actor_impl->mut);
     elements.push(std::move(item));
+    pushed_with_lock();
     actor_impl->cv.notify_one();
   }
 
   template <class... Args> void emplace(Args &&...args) {
-    std::unique_lock<std::mutex> lock(actor_impl->mut);
+    ActorImpl::Lock lock(actor_impl->mut);
     elements.emplace(std::forward<Args>(args)...);
+    pushed_with_lock();
     actor_impl->cv.notify_one();
   }
 
   T pop() {
-    std::unique_lock<std::mutex> lock(actor_impl->mut);
+    ActorImpl::Lock lock(actor_impl->mut);
     if (!readable_with_lock())
       throw std::logic_error("called pop() on unreadable channel");
+    popping_with_lock();
     T element = std::move(elements.front());
     elements.pop();
     return element;
   }
 
   T read() {
-    std::unique_lock<std::mutex> lock(actor_impl->mut);
+    ACTORPP_PROBE1(wait_enter, actor_impl.get());
+    ActorImpl::WaitTimer timer(*actor_impl);
+    ActorImpl::Lock lock(actor_impl->mut);
     actor_impl->cv.wait(lock, [&] { return readable_with_lock(); });
+    ACTORPP_PROBE2(wait_exit, actor_impl.get(), 0);
+    popping_with_lock();
     T element = std::move(elements.front());
     elements.pop();
     return element;
   }
 
+  /// cleared elements are counted as popped so that the depth stays right,
+  /// but are not recorded as sojourn samples or traced pops
   void clear() {
-    std::unique_lock<std::mutex> lock(actor_impl->mut);
+    ActorImpl::Lock lock(actor_impl->mut);
+#ifdef ACTORPP_CHANNEL_STATS
+    while (!elements.empty()) {
+      stats.on_pop(message_bytes(elements.front()));
+      elements.pop();
+    }
+#else
     elements = {};
+#endif
+#ifdef ACTORPP_CHANNEL_PUSH_TIMES
+    push_times = {};
+    stats.set_head(0);
+#endif
+#ifdef ACTORPP_TRACE
+    flows = {};
+#endif
   }
 
   bool readable() {
-    std::unique_lock<std::mutex> lock(actor_impl->mut);
+    ActorImpl::Lock lock(actor_impl->mut);
     return readable_with_lock();
   }
 
@@ -124,32 +264,61 @@ class Actor {
 public:
   std::shared_ptr<detail::ActorImpl> impl;
 
-  Actor() : impl(std::make_shared<detail::ActorImpl>()) {}
+  Actor() : impl(std::make_shared<detail::ActorImpl>()) {
+#ifdef ACTORPP_ACTOR_STATS
+    detail::register_actor(impl->stats);
+#endif
+  }
 
   /// Wait for data to arrive in one of n channels; returns the index of the
   /// first channel that has available data. All channels must be associated
-  /// with this actor.
-  template <typename... T> int wait(Channel<T> &...c) {
+  /// with this actor. As well as Channel, any type with a
+  /// `bool readable_with_lock()` method which uses this actor's lock (like
+  /// ByteChannel) can be waited for.
+  template <typename... C> int wait(C &...c) {
     return impl->wait(c...);
   }
 
   /// Wait for data to arrive in one of n channels with a timeout; returns the
   /// index of the first channel that has available data, or -1 if timeout_time
   /// is reached. All channels must be associated with this actor.
-  template <class Clock, class Duration, typename... T>
+  template <class Clock, class Duration, typename... C>
   int wait_until(const std::chrono::time_point<Clock, Duration> &timeout_time,
-                 Channel<T> &...c) {
+                 C &...c) {
     return impl->wait_until(timeout_time, c...);
   }
 
   /// Wait for data to arrive in one of n channels with a timeout; returns the
   /// index of the first channel that has available data, or -1 if rel_time has
   /// elapsed. All channels must be associated with this actor.
-  template <class Rep, class Period, typename... T>
-  int wait_for(const std::chrono::duration<Rep, Period> &rel_time,
-               Channel<T> &...c) {
+  template <class Rep, class Period, typename... C>
+  int wait_for(const std::chrono::duration<Rep, Period> &rel_time, C &...c) {
     return impl->wait_for(rel_time, c...);
   }
+
+  /// set the name of this actor, and the thread running it, for
+  /// instrumentation; this does nothing unless ACTORPP_ACTOR_STATS or
+  /// ACTORPP_LOCK_STATS is defined
+  void set_name(std::string name) {
+#ifdef ACTORPP_LOCK_STATS
+    detail::set_lock_name(impl->mut.stats, name);
+#endif
+#ifdef ACTORPP_ACTOR_STATS
+    detail::set_actor_name(impl->stats, std::move(name));
+#else
+    (void)name;
+#endif
+  }
+
+#ifdef ACTORPP_ACTOR_STATS
+  /// get the time accounting for this actor
+  ActorStats stats() const { return detail::actor_stats(impl->stats); }
+#endif
+
+#ifdef ACTORPP_LOCK_STATS
+  /// get the contention counters for the lock shared by this actor's channels
+  LockStats lock_stats() const { return detail::lock_stats(impl->mut.stats); }
+#endif
 };
 
 /// A typed channel with an unbounded number of entries
@@ -189,12 +358,31 @@ public:
 
   /// is this non-empty? requires the associated lock to be held
   bool readable_with_lock() { return impl->readable_with_lock(); }
+
+  /// set the name of this channel, for instrumentation; this does nothing
+  /// unless ACTORPP_CHANNEL_STATS is defined
+  void set_name(std::string name) {
+#ifdef ACTORPP_CHANNEL_STATS
+    detail::set_channel_name(impl->stats, std::move(name));
+#else
+    (void)name;
+#endif
+  }
+
+#ifdef ACTORPP_CHANNEL_STATS
+  /// get the counters for this channel
+  ChannelStats stats() const { return detail::channel_stats(impl->stats); }
+#endif
 };
 
 /// Wrapper around a class derived from Actor, which runs its `void run()`
 /// method in a thread, and its `void exit()` method in the destructor. For the
 /// thread to be cleaned up, `exit` must cause `run` to return.
 ///
+/// If ACTORPP_ACTOR_STATS or ACTORPP_TRACE is defined, the thread is named
+/// after the actor (see Actor::set_name); with ACTORPP_ACTOR_STATS its CPU time
+/// is also recorded.
+///
 /// This can't be implemented nicely through regular inheritance, because the
 /// constructor of a base class can't safely call derived methods, so we can't
 /// start the thread from the constructor.
@@ -203,7 +391,7 @@ class ActorThread : public ActorT, private detail::IActorThread {
 public:
   template <typename... Args>
   ActorThread(Args &&...args)
-      : ActorT(std::forward<Args>(args)...), thread([&] { this->run(); }) {}
+      : ActorT(std::forward<Args>(args)...), thread([&] { run_thread(); }) {}
 
   ~ActorThread() {
     this->exit();
@@ -211,10 +399,25 @@ public:
   }
 
 private:
+  void run_thread() {
+#ifdef ACTORPP_LOCK_STATS
+    detail::LockStatsEntry *lock_entry = detail::actor_lock_stats(*this, 0);
+    if (lock_entry)
+      detail::set_lock_name(*lock_entry,
+                            detail::short_type_name(typeid(ActorT)), true);
+#endif
+#if defined(ACTORPP_ACTOR_STATS) || defined(ACTORPP_TRACE)
+    detail::ActorThreadScope scope(detail::actor_stats_entry(*this, 0),
+                                   typeid(ActorT));
+#endif
+    this->run();
+  }
+
   std::thread thread;
 
   static_assert(!std::is_base_of<detail::IActorThread, ActorT>::value,
                 "ActorThread must only be applied once to an Actor");
 };
 
+} // namespace ACTORPP_CONFIG_NAMESPACE
 } // namespace actorpp
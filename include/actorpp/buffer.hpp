@@ -0,0 +1,161 @@
+#pragma once
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+namespace actorpp {
+
+/// An immutable, reference-counted range of bytes. Copies and slices share the
+/// underlying storage, so they are cheap to make, and can be pushed to many
+/// channels without copying the data.
+class Buffer {
+public:
+  Buffer() : offset(0), length(0) {}
+
+  /// take ownership of data
+  explicit Buffer(std::vector<uint8_t> data)
+      : storage(std::make_shared<std::vector<uint8_t>>(std::move(data))),
+        offset(0), length(storage->size()) {}
+
+  /// copy size bytes from data
+  Buffer(const void *data, size_t size)
+      : Buffer(std::vector<uint8_t>((const uint8_t *)data,
+                                    (const uint8_t *)data + size)) {}
+
+  /// share length bytes from offset in storage
+  Buffer(std::shared_ptr<const std::vector<uint8_t>> storage, size_t offset,
+         size_t length)
+      : storage(std::move(storage)), offset(offset), length(length) {
+    if (length > 0 && offset + length > this->storage->size())
+      throw std::out_of_range("Buffer range outside storage");
+  }
+
+  const uint8_t *data() const {
+    return length ? storage->data() + offset : nullptr;
+  }
+  size_t size() const { return length; }
+  bool empty() const { return length == 0; }
+
+  const uint8_t *begin() const { return data(); }
+  const uint8_t *end() const { return data() + length; }
+
+  uint8_t operator[](size_t i) const { return data()[i]; }
+
+  /// get length bytes starting at offset, sharing storage with this
+  Buffer slice(size_t offset, size_t length) const {
+    if (offset > this->length || length > this->length - offset)
+      throw std::out_of_range("Buffer slice out of range");
+    return Buffer(storage, this->offset + offset, length);
+  }
+
+  /// get the bytes from offset to the end, sharing storage with this
+  Buffer slice(size_t offset) const {
+    if (offset > length)
+      throw std::out_of_range("Buffer slice out of range");
+    return slice(offset, length - offset);
+  }
+
+  /// copy the contents into a vector
+  std::vector<uint8_t> to_vector() const {
+    return std::vector<uint8_t>(begin(), end());
+  }
+
+  bool operator==(const Buffer &other) const {
+    return length == other.length &&
+           (length == 0 || memcmp(data(), other.data(), length) == 0);
+  }
+  bool operator!=(const Buffer &other) const { return !(*this == other); }
+
+private:
+  std::shared_ptr<const std::vector<uint8_t>> storage;
+  size_t offset;
+  size_t length;
+};
+
+/// A message made of a sequence of Buffers, which can be built up, sliced and
+/// consumed without copying the data.
+class BufferChain {
+public:
+  BufferChain() : length(0) {}
+  BufferChain(Buffer buffer) : length(0) { append(std::move(buffer)); }
+
+  /// add a buffer to the end; empty buffers are ignored
+  void append(Buffer buffer) {
+    if (buffer.empty())
+      return;
+    length += buffer.size();
+    parts.push_back(std::move(buffer));
+  }
+
+  void append(const BufferChain &chain) {
+    for (const Buffer &buffer : chain.parts)
+      append(buffer);
+  }
+
+  /// the total number of bytes
+  size_t size() const { return length; }
+  bool empty() const { return length == 0; }
+
+  /// the non-empty buffers which make up this chain
+  const std::vector<Buffer> &buffers() const { return parts; }
+
+  /// get length bytes starting at offset, sharing storage with this
+  BufferChain slice(size_t offset, size_t length) const {
+    if (offset > this->length || length > this->length - offset)
+      throw std::out_of_range("BufferChain slice out of range");
+
+    BufferChain result;
+    for (const Buffer &buffer : parts) {
+      if (length == 0)
+        break;
+      if (offset >= buffer.size()) {
+        offset -= buffer.size();
+        continue;
+      }
+      size_t n = std::min(length, buffer.size() - offset);
+      result.append(buffer.slice(offset, n));
+      offset = 0;
+      length -= n;
+    }
+    return result;
+  }
+
+  /// remove n bytes from the start
+  void consume(size_t n) {
+    if (n > length)
+      throw std::out_of_range("BufferChain consume out of range");
+    *this = slice(n, length - n);
+  }
+
+  /// copy length bytes starting at offset into dest
+  void copy_to(size_t offset, void *dest, size_t length) const {
+    BufferChain range = slice(offset, length);
+    uint8_t *out = (uint8_t *)dest;
+    for (const Buffer &buffer : range.parts) {
+      memcpy(out, buffer.data(), buffer.size());
+      out += buffer.size();
+    }
+  }
+
+  /// get the contents as one Buffer; this only copies if there is more than
+  /// one part
+  Buffer flatten() const {
+    if (parts.size() == 0)
+      return Buffer();
+    if (parts.size() == 1)
+      return parts[0];
+
+    std::vector<uint8_t> data(length);
+    copy_to(0, data.data(), length);
+    return Buffer(std::move(data));
+  }
+
+private:
+  std::vector<Buffer> parts;
+  size_t length;
+};
+
+} // namespace actorpp
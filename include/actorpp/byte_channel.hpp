@@ -0,0 +1,208 @@
+#pragma once
+#include "actor.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace actorpp {
+inline namespace ACTORPP_CONFIG_NAMESPACE {
+
+/// a contiguous range of bytes in a ByteChannel
+struct ByteSpan {
+  const uint8_t *data;
+  size_t size;
+};
+
+/// a contiguous range of free space in a ByteChannel
+struct MutableByteSpan {
+  uint8_t *data;
+  size_t size;
+};
+
+namespace detail {
+/// a region of memory mapped twice in a row, so that a ring buffer in it can
+/// always be accessed contiguously from any offset
+class MirroredMapping {
+public:
+  MirroredMapping(size_t min_size) {
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    size = std::max((min_size + page_size - 1) / page_size * page_size,
+                    page_size);
+
+    int fd = memfd_create("actorpp_byte_channel", MFD_CLOEXEC);
+    if (fd < 0)
+      throw std::runtime_error("memfd_create() failed");
+    if (ftruncate(fd, size) != 0) {
+      close(fd);
+      throw std::runtime_error("ftruncate() failed");
+    }
+
+    // reserve the whole range, then map the file over each half
+    void *addr =
+        mmap(NULL, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED) {
+      close(fd);
+      throw std::runtime_error("mmap() failed");
+    }
+    base = (uint8_t *)addr;
+
+    for (int half = 0; half < 2; half++)
+      if (mmap(base + half * size, size, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, 2 * size);
+        close(fd);
+        throw std::runtime_error("mmap() failed");
+      }
+
+    close(fd);
+  }
+
+  ~MirroredMapping() { munmap(base, 2 * size); }
+
+  MirroredMapping(const MirroredMapping &) = delete;
+  MirroredMapping &operator=(const MirroredMapping &) = delete;
+
+  uint8_t *base;
+  size_t size;
+};
+
+struct ByteChannelImpl {
+  ByteChannelImpl(std::shared_ptr<ActorImpl> actor_impl, size_t capacity)
+      : actor_impl(std::move(actor_impl)), mapping(capacity) {}
+  std::shared_ptr<detail::ActorImpl> actor_impl;
+  ActorImpl::ConditionVariable space_cv;
+  MirroredMapping mapping;
+  uint64_t read_pos = 0;
+  uint64_t write_pos = 0;
+
+  size_t free_with_lock() {
+    return mapping.size - (size_t)(write_pos - read_pos);
+  }
+
+  uint8_t *at(uint64_t pos) { return mapping.base + pos % mapping.size; }
+
+  MutableByteSpan reserve(bool block) {
+    ActorImpl::Lock lock(actor_impl->mut);
+    if (block)
+      space_cv.wait(lock, [&] { return free_with_lock() > 0; });
+    return MutableByteSpan{at(write_pos), free_with_lock()};
+  }
+
+  void commit(size_t n) {
+    ActorImpl::Lock lock(actor_impl->mut);
+    if (n > free_with_lock())
+      throw std::logic_error("committed more than was reserved");
+    write_pos += n;
+    actor_impl->cv.notify_one();
+  }
+
+  size_t write(const uint8_t *data, size_t size, bool block) {
+    size_t written = 0;
+    while (written < size) {
+      // the reader never touches free space, so the copy can be done without
+      // holding the lock
+      MutableByteSpan space = reserve(block);
+      if (space.size == 0)
+        break;
+      size_t n = std::min(space.size, size - written);
+      memcpy(space.data, data + written, n);
+      commit(n);
+      written += n;
+    }
+    return written;
+  }
+
+  ByteSpan peek() {
+    ActorImpl::Lock lock(actor_impl->mut);
+    return ByteSpan{at(read_pos), (size_t)(write_pos - read_pos)};
+  }
+
+  void consume(size_t n) {
+    ActorImpl::Lock lock(actor_impl->mut);
+    if (n > write_pos - read_pos)
+      throw std::logic_error("consumed more than is available");
+    read_pos += n;
+    space_cv.notify_all();
+  }
+
+  void clear() {
+    ActorImpl::Lock lock(actor_impl->mut);
+    read_pos = write_pos;
+    space_cv.notify_all();
+  }
+
+  bool readable() {
+    ActorImpl::Lock lock(actor_impl->mut);
+    return readable_with_lock();
+  }
+
+  bool readable_with_lock() { return write_pos != read_pos; }
+};
+} // namespace detail
+
+/// A bounded byte stream between one writer and one reader. The buffer is a
+/// ring mapped twice in a row in memory, so the reader always sees all pending
+/// data as one contiguous span, and parsers can run directly over it without
+/// reassembling fragments.
+///
+/// Like Channel, this can be associated with an Actor, and waited for with
+/// Actor::wait.
+class ByteChannel {
+  std::shared_ptr<detail::ByteChannelImpl> impl;
+
+public:
+  /// associated with a specified actor, with space for at least capacity
+  /// bytes (rounded up to a whole number of pages)
+  ByteChannel(Actor &actor, size_t capacity)
+      : impl(std::make_shared<detail::ByteChannelImpl>(actor.impl, capacity)) {
+  }
+  /// not associated with any actor
+  ByteChannel(size_t capacity)
+      : impl(std::make_shared<detail::ByteChannelImpl>(
+            std::make_shared<detail::ActorImpl>(), capacity)) {}
+
+  /// the number of bytes which can be held
+  size_t capacity() const { return impl->mapping.size; }
+
+  /// write all of data, blocking while the channel is full
+  void write(const void *data, size_t size) {
+    impl->write((const uint8_t *)data, size, true);
+  }
+
+  /// write as much of data as will fit without blocking; returns the number
+  /// of bytes written
+  size_t try_write(const void *data, size_t size) {
+    return impl->write((const uint8_t *)data, size, false);
+  }
+
+  /// get the free space, to be written directly (for example with recv) and
+  /// then committed; this does not block, so the span may be empty
+  MutableByteSpan reserve() { return impl->reserve(false); }
+
+  /// make n bytes written to the span returned by reserve() available
+  void commit(size_t n) { impl->commit(n); }
+
+  /// get all pending data, which stays valid until it is consumed
+  ByteSpan peek() { return impl->peek(); }
+
+  /// remove n bytes from the start of the pending data
+  void consume(size_t n) { impl->consume(n); }
+
+  /// remove all pending data
+  void clear() { impl->clear(); }
+
+  /// is this non-empty?
+  bool readable() { return impl->readable(); }
+
+  /// is this non-empty? requires the associated lock to be held
+  bool readable_with_lock() { return impl->readable_with_lock(); }
+};
+
+} // namespace ACTORPP_CONFIG_NAMESPACE
+} // namespace actorpp
@@ -0,0 +1,93 @@
+#pragma once
+// Settings which change the layout of actorpp types: the instrumentation
+// macros (ACTORPP_CHANNEL_STATS and so on, see README.md) and the RecvThread
+// implementation (ACTORPP_RECV_THREAD_*). These must be the same in every
+// translation unit of a program; set them for the whole build, for example
+// with target_compile_definitions(... PUBLIC ...) on the target which links
+// actorpp.
+//
+// Everything which depends on them is declared in an inline namespace named
+// after the settings, so that actorpp types built with different settings are
+// distinct types. A function taking an actorpp type which is defined in a
+// translation unit with one setting then fails to link with calls from a
+// translation unit with another, rather than the two silently disagreeing
+// about the layout.
+
+#ifdef ACTORPP_WATCHDOG
+#ifndef ACTORPP_CHANNEL_STATS
+#define ACTORPP_CHANNEL_STATS
+#endif
+#ifndef ACTORPP_ACTOR_STATS
+#define ACTORPP_ACTOR_STATS
+#endif
+#endif
+
+#if defined(ACTORPP_CHANNEL_LATENCY) && !defined(ACTORPP_CHANNEL_STATS)
+#define ACTORPP_CHANNEL_STATS
+#endif
+
+// record the time each element was pushed
+#if defined(ACTORPP_CHANNEL_LATENCY) || defined(ACTORPP_WATCHDOG)
+#define ACTORPP_CHANNEL_PUSH_TIMES
+#endif
+
+#if !defined(ACTORPP_RECV_THREAD_SHUTDOWN) &&                                 \
+    !defined(ACTORPP_RECV_THREAD_PIPE) && !defined(ACTORPP_RECV_THREAD_EVENTFD)
+#define ACTORPP_RECV_THREAD_PIPE
+#endif
+
+#ifdef ACTORPP_CHANNEL_STATS
+#define ACTORPP_CONFIG_CHANNEL_STATS _channel_stats
+#else
+#define ACTORPP_CONFIG_CHANNEL_STATS
+#endif
+
+#ifdef ACTORPP_CHANNEL_LATENCY
+#define ACTORPP_CONFIG_CHANNEL_LATENCY _latency
+#else
+#define ACTORPP_CONFIG_CHANNEL_LATENCY
+#endif
+
+#ifdef ACTORPP_ACTOR_STATS
+#define ACTORPP_CONFIG_ACTOR_STATS _actor_stats
+#else
+#define ACTORPP_CONFIG_ACTOR_STATS
+#endif
+
+#ifdef ACTORPP_TRACE
+#define ACTORPP_CONFIG_TRACE _trace
+#else
+#define ACTORPP_CONFIG_TRACE
+#endif
+
+#ifdef ACTORPP_LOCK_STATS
+#define ACTORPP_CONFIG_LOCK_STATS _lock_stats
+#else
+#define ACTORPP_CONFIG_LOCK_STATS
+#endif
+
+#ifdef ACTORPP_WATCHDOG
+#define ACTORPP_CONFIG_WATCHDOG _watchdog
+#else
+#define ACTORPP_CONFIG_WATCHDOG
+#endif
+
+#if defined(ACTORPP_RECV_THREAD_SHUTDOWN)
+#define ACTORPP_CONFIG_RECV_THREAD _shutdown
+#elif defined(ACTORPP_RECV_THREAD_EVENTFD)
+#define ACTORPP_CONFIG_RECV_THREAD _eventfd
+#else
+#define ACTORPP_CONFIG_RECV_THREAD _pipe
+#endif
+
+#define ACTORPP_CONFIG_CAT(a, b, c, d, e, f, g) config##a##b##c##d##e##f##g
+#define ACTORPP_CONFIG_NAME(a, b, c, d, e, f, g)                               \
+  ACTORPP_CONFIG_CAT(a, b, c, d, e, f, g)
+
+/// the name of the inline namespace, for example config_channel_stats_pipe
+#define ACTORPP_CONFIG_NAMESPACE                                               \
+  ACTORPP_CONFIG_NAME(ACTORPP_CONFIG_CHANNEL_STATS,                            \
+                      ACTORPP_CONFIG_CHANNEL_LATENCY,                          \
+                      ACTORPP_CONFIG_ACTOR_STATS, ACTORPP_CONFIG_TRACE,        \
+                      ACTORPP_CONFIG_LOCK_STATS, ACTORPP_CONFIG_WATCHDOG,      \
+                      ACTORPP_CONFIG_RECV_THREAD)
@@ -0,0 +1,102 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) &&                              \
+    (defined(__GNUC__) || defined(__clang__))
+#define ACTORPP_CRC32C_SSE42
+#include <nmmintrin.h>
+#endif
+
+namespace actorpp {
+
+namespace detail {
+/// tables for slicing-by-8: table[0] is the normal byte-at-a-time table, and
+/// table[k][i] is the CRC of byte i followed by k zero bytes
+struct Crc32cTables {
+  uint32_t table[8][256];
+
+  Crc32cTables() {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t crc = i;
+      for (int bit = 0; bit < 8; bit++)
+        crc = (crc & 1) ? (crc >> 1) ^ 0x82f63b78 : crc >> 1;
+      table[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; i++)
+      for (int k = 1; k < 8; k++)
+        table[k][i] =
+            (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xff];
+  }
+};
+
+inline const Crc32cTables &crc32c_tables() {
+  static const Crc32cTables tables;
+  return tables;
+}
+
+/// portable CRC32C, processing 8 bytes per step
+inline uint32_t crc32c_sw(const uint8_t *data, size_t size, uint32_t crc) {
+  const uint32_t(&t)[8][256] = crc32c_tables().table;
+  crc = ~crc;
+
+  for (; size >= 8; data += 8, size -= 8) {
+    uint32_t low = crc ^ (uint32_t(data[0]) | uint32_t(data[1]) << 8 |
+                          uint32_t(data[2]) << 16 | uint32_t(data[3]) << 24);
+    crc = t[7][low & 0xff] ^ t[6][(low >> 8) & 0xff] ^
+          t[5][(low >> 16) & 0xff] ^ t[4][low >> 24] ^ t[3][data[4]] ^
+          t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+  }
+  for (; size > 0; data++, size--)
+    crc = t[0][(crc ^ *data) & 0xff] ^ (crc >> 8);
+
+  return ~crc;
+}
+
+#ifdef ACTORPP_CRC32C_SSE42
+/// CRC32C using the SSE4.2 crc32 instruction; only call this if
+/// crc32c_hw_supported()
+__attribute__((target("sse4.2"))) inline uint32_t
+crc32c_hw(const uint8_t *data, size_t size, uint32_t crc) {
+  crc = ~crc;
+#ifdef __x86_64__
+  uint64_t crc64 = crc;
+  for (; size >= 8; data += 8, size -= 8) {
+    uint64_t word;
+    memcpy(&word, data, 8);
+    crc64 = _mm_crc32_u64(crc64, word);
+  }
+  crc = crc64;
+#endif
+  for (; size >= 4; data += 4, size -= 4) {
+    uint32_t word;
+    memcpy(&word, data, 4);
+    crc = _mm_crc32_u32(crc, word);
+  }
+  for (; size > 0; data++, size--)
+    crc = _mm_crc32_u8(crc, *data);
+  return ~crc;
+}
+
+inline bool crc32c_hw_supported() {
+  static const bool supported = __builtin_cpu_supports("sse4.2");
+  return supported;
+}
+#endif
+} // namespace detail
+
+/// compute the CRC32C (Castagnoli) checksum of data. To checksum data in
+/// several parts, pass the result for the previous parts as crc.
+///
+/// On x86 this uses the SSE4.2 crc32 instruction if the CPU supports it, and a
+/// portable slicing-by-8 implementation otherwise.
+inline uint32_t crc32c(const void *data, size_t size, uint32_t crc = 0) {
+#ifdef ACTORPP_CRC32C_SSE42
+  if (detail::crc32c_hw_supported())
+    return detail::crc32c_hw((const uint8_t *)data, size, crc);
+#endif
+  return detail::crc32c_sw((const uint8_t *)data, size, crc);
+}
+
+} // namespace actorpp
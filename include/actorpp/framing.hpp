@@ -0,0 +1,246 @@
+#pragma once
+#include "actor.hpp"
+#include "buffer.hpp"
+#include "crc32c.hpp"
+#include "net.hpp"
+#include <stdexcept>
+#include <stdint.h>
+#include <vector>
+
+namespace actorpp {
+inline namespace ACTORPP_CONFIG_NAMESPACE {
+
+/// the size of the length prefix before each frame
+constexpr size_t frame_header_size = 4;
+
+/// the size of the checksum after each frame, if enabled
+constexpr size_t frame_trailer_size = 4;
+
+/// integrity checking for frames; both ends of a connection must agree
+enum class FrameChecksum {
+  None,
+  /// each frame is followed by the big-endian CRC32C of the length prefix and
+  /// payload
+  CRC32C,
+};
+
+namespace detail {
+inline void write_be32(uint8_t *out, uint32_t value) {
+  for (int i = 0; i < 4; i++)
+    out[i] = value >> (8 * (3 - i));
+}
+
+inline uint32_t read_be32(const uint8_t *in) {
+  uint32_t value = 0;
+  for (int i = 0; i < 4; i++)
+    value = (value << 8) | in[i];
+  return value;
+}
+
+inline uint32_t crc32c(const BufferChain &chain, uint32_t crc = 0) {
+  for (const Buffer &buffer : chain.buffers())
+    crc = actorpp::crc32c(buffer.data(), buffer.size(), crc);
+  return crc;
+}
+
+/// Receiver which splits a stream into frames, each with a 32 bit big-endian
+/// length prefix, and calls handler with each complete frame. handler returns
+/// false if the frame is invalid, which closes the stream with an error, as
+/// does a frame longer than max_frame_size, or one with the wrong checksum.
+template <typename Handler> class FrameReceiver {
+public:
+  FrameReceiver(Handler handler, size_t max_frame_size,
+                FrameChecksum checksum = FrameChecksum::None)
+      : handler(std::move(handler)), max_frame_size(max_frame_size),
+        trailer_size(checksum == FrameChecksum::CRC32C ? frame_trailer_size
+                                                       : 0) {}
+
+  ssize_t receive(int fd, CloseReason &reason) {
+    Buffer buffer;
+    ssize_t bytes_read = reader.read(fd, buffer);
+    if (bytes_read <= 0) {
+      reason = pending.empty() ? CloseReason::Normal : CloseReason::Error;
+      return -1;
+    }
+    pending.append(std::move(buffer));
+
+    while (pending.size() >= frame_header_size) {
+      uint8_t header[frame_header_size];
+      pending.copy_to(0, header, frame_header_size);
+      size_t length = read_be32(header);
+      if (length > max_frame_size) {
+        reason = CloseReason::Error;
+        return -1;
+      }
+      if (pending.size() < frame_header_size + length + trailer_size)
+        break;
+
+      if (trailer_size) {
+        uint8_t trailer[frame_trailer_size];
+        pending.copy_to(frame_header_size + length, trailer,
+                        frame_trailer_size);
+        if (crc32c(pending.slice(0, frame_header_size + length)) !=
+            read_be32(trailer)) {
+          reason = CloseReason::Error;
+          return -1;
+        }
+      }
+
+      Buffer frame = pending.slice(frame_header_size, length).flatten();
+      pending.consume(frame_header_size + length + trailer_size);
+      if (!handler(std::move(frame))) {
+        reason = CloseReason::Error;
+        return -1;
+      }
+    }
+
+    return bytes_read;
+  }
+
+private:
+  Handler handler;
+  size_t max_frame_size;
+  size_t trailer_size;
+  BlockReader reader;
+  BufferChain pending;
+};
+
+/// FrameReceiver handler which pushes frames into a channel
+struct PushFrame {
+  Channel<Buffer> on_frame;
+
+  bool operator()(Buffer frame) {
+    on_frame.push(std::move(frame));
+    return true;
+  }
+};
+} // namespace detail
+
+/// Actor which reads length-prefixed frames sent by a FrameSendThread from a
+/// stream socket, and pushes the payload of each to on_frame. Frames spanning
+/// several reads are copied into one Buffer; others share the read buffers.
+///
+/// on_close is pushed CloseReason::Normal if the socket is closed between
+/// frames, and CloseReason::Error if it is closed part way through a frame, or
+/// a frame is longer than max_frame_size, or fails its checksum. budget
+/// counts bytes read from the socket, including the length prefixes and
+/// checksums.
+class FrameRecvThread
+    : public detail::RecvThreadBase<detail::FrameReceiver<detail::PushFrame>> {
+public:
+  FrameRecvThread(int fd, Channel<Buffer> on_frame,
+                  Channel<CloseReason> on_close,
+                  size_t max_frame_size = 16 * 1024 * 1024,
+                  FrameChecksum checksum = FrameChecksum::None,
+                  ByteBudget budget = ByteBudget())
+      : RecvThreadBase(fd,
+                       detail::FrameReceiver<detail::PushFrame>(
+                           detail::PushFrame{std::move(on_frame)},
+                           max_frame_size, checksum),
+                       std::move(on_close), std::move(budget)) {}
+};
+
+/// Actor which sends each BufferChain pushed to `frames` as one
+/// length-prefixed frame. All frames which are waiting when the thread wakes
+/// (up to max_batch_size bytes) are sent with one send_all call, so that under
+/// load many small frames share each system call. If checksum is set, a
+/// trailer is added to each frame.
+///
+/// Frames pushed before exit() is called are sent before the thread exits, so
+/// exiting may block until the peer reads them. If sending fails,
+/// CloseReason::Error is pushed to on_close, and no more frames are sent.
+class FrameSendThread : public Actor {
+public:
+  FrameSendThread(int fd, Channel<CloseReason> on_close,
+                  size_t max_batch_size = 256 * 1024,
+                  FrameChecksum checksum = FrameChecksum::None)
+      : frames(*this), fd(fd), on_close(std::move(on_close)),
+        max_batch_size(max_batch_size), checksum(checksum), do_exit(*this) {}
+
+  Channel<BufferChain> frames;
+
+  void run() {
+    while (true) {
+      switch (wait(frames, do_exit)) {
+      case 0:
+        if (!send_batch()) {
+          on_close.push(CloseReason::Error);
+          return;
+        }
+        break;
+      case 1:
+        if (do_exit.pop()) {
+          while (frames.readable())
+            if (!send_batch()) {
+              on_close.push(CloseReason::Error);
+              return;
+            }
+          return;
+        }
+        break;
+      }
+    }
+  }
+
+  void exit() { do_exit.push(true); }
+
+private:
+  bool send_batch() {
+    std::vector<BufferChain> batch;
+    size_t batch_size = 0;
+    while (batch_size < max_batch_size && frames.readable()) {
+      batch.push_back(frames.pop());
+      batch_size += batch.back().size();
+    }
+
+    for (const BufferChain &frame : batch)
+      if (frame.size() > UINT32_MAX)
+        return false;
+
+    // one block holds the headers for the whole batch, and another the
+    // trailers
+    std::vector<uint8_t> headers(batch.size() * frame_header_size);
+    for (size_t i = 0; i < batch.size(); i++)
+      detail::write_be32(headers.data() + i * frame_header_size,
+                         batch[i].size());
+
+    std::vector<uint8_t> trailers;
+    if (checksum == FrameChecksum::CRC32C) {
+      trailers.resize(batch.size() * frame_trailer_size);
+      for (size_t i = 0; i < batch.size(); i++) {
+        uint32_t crc =
+            crc32c(headers.data() + i * frame_header_size, frame_header_size);
+        detail::write_be32(trailers.data() + i * frame_trailer_size,
+                           detail::crc32c(batch[i], crc));
+      }
+    }
+
+    Buffer headers_buf(std::move(headers));
+    Buffer trailers_buf(std::move(trailers));
+
+    BufferChain out;
+    for (size_t i = 0; i < batch.size(); i++) {
+      out.append(headers_buf.slice(i * frame_header_size, frame_header_size));
+      out.append(batch[i]);
+      if (!trailers_buf.empty())
+        out.append(
+            trailers_buf.slice(i * frame_trailer_size, frame_trailer_size));
+    }
+
+    try {
+      send_all(fd, out);
+    } catch (const std::runtime_error &) {
+      return false;
+    }
+    return true;
+  }
+
+  int fd;
+  Channel<CloseReason> on_close;
+  size_t max_batch_size;
+  FrameChecksum checksum;
+  Channel<bool> do_exit;
+};
+
+} // namespace ACTORPP_CONFIG_NAMESPACE
+} // namespace actorpp
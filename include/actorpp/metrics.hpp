@@ -0,0 +1,301 @@
+#pragma once
+// Prometheus text exposition of the instrumentation counters, and an actor
+// which serves it over HTTP
+#include "actor.hpp"
+#include "net.hpp"
+#include <errno.h>
+#include <ostream>
+#include <sstream>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <vector>
+
+namespace actorpp {
+inline namespace ACTORPP_CONFIG_NAMESPACE {
+
+namespace detail {
+inline void write_metric_header(std::ostream &out, const char *metric,
+                                const char *type, const char *help) {
+  out << "# HELP " << metric << " " << help << "\n# TYPE " << metric << " "
+      << type << "\n";
+}
+
+/// write a label value, escaping backslashes, quotes and newlines
+inline void write_label_value(std::ostream &out, const std::string &value) {
+  out << '"';
+  for (char c : value) {
+    if (c == '\\' || c == '"')
+      out << '\\' << c;
+    else if (c == '\n')
+      out << "\\n";
+    else
+      out << c;
+  }
+  out << '"';
+}
+
+/// write a value, which is a count, or a time in nanoseconds which is written
+/// in seconds
+inline void write_metric_value(std::ostream &out, uint64_t value,
+                               bool seconds) {
+  char formatted[32];
+  if (seconds)
+    snprintf(formatted, sizeof(formatted), "%llu.%09u",
+             (unsigned long long)(value / 1000000000),
+             (unsigned)(value % 1000000000));
+  else
+    snprintf(formatted, sizeof(formatted), "%llu", (unsigned long long)value);
+  out << formatted;
+}
+
+/// write the start of a sample for a channel, actor or lock, which are
+/// labelled with their id and name; extra_labels is added to the labels
+template <typename Stats>
+void write_sample_start(std::ostream &out, const char *metric,
+                        const Stats &stats, const char *extra_labels = "") {
+  out << metric << "{id=\"" << stats.id << "\",name=";
+  write_label_value(out, stats.name);
+  out << extra_labels << "} ";
+}
+
+/// write a metric with one sample for each of stats, with the value given by
+/// calling value with each
+template <typename Stats, typename Value>
+void write_metric(std::ostream &out, const char *metric, const char *type,
+                  const char *help, const std::vector<Stats> &stats,
+                  bool seconds, Value value) {
+  write_metric_header(out, metric, type, help);
+  for (const Stats &s : stats) {
+    write_sample_start(out, metric, s);
+    write_metric_value(out, value(s), seconds);
+    out << "\n";
+  }
+}
+} // namespace detail
+
+/// Write the counters enabled by the instrumentation macros in the Prometheus
+/// text exposition format: for each live channel, actor and lock, labelled
+/// with its id and name, and the number of running ActorThreads. Metrics
+/// whose macros are not defined are left out.
+///
+/// The counters are read in the same way as channel_stats, actor_stats and
+/// lock_stats, without taking the locks of the channels and actors, so this
+/// doesn't slow down busy actors.
+inline void write_prometheus_metrics(std::ostream &out) {
+#ifdef ACTORPP_CHANNEL_STATS
+  typedef ChannelStats C;
+  std::vector<ChannelStats> channels = channel_stats();
+
+  detail::write_metric(out, "actorpp_channel_depth", "gauge",
+                       "Number of elements in the channel.", channels, false,
+                       [](const C &s) { return s.depth; });
+  detail::write_metric(out, "actorpp_channel_high_water", "gauge",
+                       "Largest number of elements seen in the channel.",
+                       channels, false,
+                       [](const C &s) { return s.high_water; });
+  detail::write_metric(out, "actorpp_channel_pushed_total", "counter",
+                       "Elements pushed to the channel.", channels, false,
+                       [](const C &s) { return s.pushed; });
+  detail::write_metric(out, "actorpp_channel_popped_total", "counter",
+                       "Elements popped from the channel.", channels, false,
+                       [](const C &s) { return s.popped; });
+  detail::write_metric(out, "actorpp_channel_pushed_bytes_total", "counter",
+                       "Bytes pushed to the channel, for sized elements.",
+                       channels, false,
+                       [](const C &s) { return s.bytes_pushed; });
+  detail::write_metric(out, "actorpp_channel_popped_bytes_total", "counter",
+                       "Bytes popped from the channel, for sized elements.",
+                       channels, false,
+                       [](const C &s) { return s.bytes_popped; });
+#ifdef ACTORPP_CHANNEL_PUSH_TIMES
+  detail::write_metric(out, "actorpp_channel_head_age_seconds", "gauge",
+                       "Time the oldest element has been in the channel.",
+                       channels, true,
+                       [](const C &s) { return s.head_age_ns; });
+#endif
+#ifdef ACTORPP_CHANNEL_LATENCY
+  // there is no _sum, as the histogram doesn't record one
+  const char *sojourn = "actorpp_channel_sojourn_seconds";
+  detail::write_metric_header(out, sojourn, "summary",
+                              "Time elements spent in the channel.");
+  for (const ChannelStats &s : channels) {
+    static const struct {
+      const char *label;
+      double percentile;
+    } quantiles[] = {{",quantile=\"0.5\"", 50.0},
+                     {",quantile=\"0.9\"", 90.0},
+                     {",quantile=\"0.99\"", 99.0},
+                     {",quantile=\"1\"", 100.0}};
+    for (const auto &q : quantiles) {
+      detail::write_sample_start(out, sojourn, s, q.label);
+      detail::write_metric_value(out, s.sojourn_ns.percentile(q.percentile),
+                                 true);
+      out << "\n";
+    }
+    detail::write_sample_start(out, "actorpp_channel_sojourn_seconds_count",
+                               s);
+    detail::write_metric_value(out, s.sojourn_ns.count(), false);
+    out << "\n";
+  }
+#endif
+#endif
+
+#ifdef ACTORPP_ACTOR_STATS
+  typedef ActorStats A;
+  std::vector<ActorStats> actors = actor_stats();
+
+  detail::write_metric(out, "actorpp_actor_blocked_seconds_total", "counter",
+                       "Time the actor spent waiting for messages.", actors,
+                       true, [](const A &s) { return s.blocked_ns; });
+  detail::write_metric(out, "actorpp_actor_running_seconds_total", "counter",
+                       "Time the actor spent not waiting for messages.",
+                       actors, true,
+                       [](const A &s) { return s.running_ns; });
+  detail::write_metric(out, "actorpp_actor_cpu_seconds_total", "counter",
+                       "CPU time used by the thread running the actor.",
+                       actors, true, [](const A &s) { return s.cpu_ns; });
+  detail::write_metric(out, "actorpp_actor_waits_total", "counter",
+                       "Calls by the actor which could block.", actors, false,
+                       [](const A &s) { return s.waits; });
+  detail::write_metric(out, "actorpp_actor_since_wait_seconds", "gauge",
+                       "Time since the actor last returned from a wait.",
+                       actors, true,
+                       [](const A &s) { return s.since_wait_ns; });
+#endif
+
+#if defined(ACTORPP_ACTOR_STATS) || defined(ACTORPP_TRACE)
+  detail::write_metric_header(out, "actorpp_actor_threads", "gauge",
+                              "Number of running ActorThreads.");
+  out << "actorpp_actor_threads ";
+  detail::write_metric_value(out, actor_thread_count(), false);
+  out << "\n";
+#endif
+
+#ifdef ACTORPP_LOCK_STATS
+  typedef LockStats L;
+  std::vector<LockStats> locks = lock_stats();
+
+  detail::write_metric(out, "actorpp_lock_acquisitions_total", "counter",
+                       "Acquisitions of the lock.", locks, false,
+                       [](const L &s) { return s.acquisitions; });
+  detail::write_metric(out, "actorpp_lock_contended_total", "counter",
+                       "Acquisitions which waited for another thread.", locks,
+                       false, [](const L &s) { return s.contended; });
+  detail::write_metric(out, "actorpp_lock_wait_seconds_total", "counter",
+                       "Time spent waiting to acquire the lock.", locks, true,
+                       [](const L &s) { return s.wait_ns; });
+  detail::write_metric(out, "actorpp_lock_hold_seconds_total", "counter",
+                       "Time the lock was held.", locks, true,
+                       [](const L &s) { return s.hold_ns; });
+#endif
+  (void)out;
+}
+
+/// the output of write_prometheus_metrics as a string
+inline std::string prometheus_metrics() {
+  std::ostringstream out;
+  write_prometheus_metrics(out);
+  return out.str();
+}
+
+/// Actor which serves write_prometheus_metrics over HTTP, for scraping by
+/// Prometheus or similar. GET requests for path are answered with the
+/// metrics; anything else gets an error. Connections are handled one at a
+/// time and closed after each response.
+///
+/// The default port is 0 (any free port, see port()) and the default hostname
+/// is localhost, so the metrics are not exposed to other hosts unless asked
+/// for.
+class MetricsExporter : public Actor {
+public:
+  MetricsExporter(int port = 0, const std::string &hostname = "localhost",
+                  std::string path = "/metrics")
+      : listen_fd(actorpp::listen(hostname, port)), path(std::move(path)) {
+    set_name("MetricsExporter");
+  }
+  ~MetricsExporter() { close(listen_fd); }
+
+  /// the port being listened on
+  int port() const { return local_port(listen_fd); }
+
+  void run() {
+    while (true) {
+      int fd = ::accept(listen_fd, NULL, NULL);
+      if (fd < 0) {
+        if (errno == EINTR || errno == ECONNABORTED)
+          continue;
+        return;
+      }
+
+      serve(fd);
+      close(fd);
+    }
+  }
+
+  // wakes accept
+  void exit() { shutdown(listen_fd, SHUT_RDWR); }
+
+private:
+  /// the longest request which will be read
+  static constexpr size_t max_request = 8192;
+
+  void serve(int fd) {
+    // don't let a slow client block exit for long
+    struct timeval timeout = {1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    std::string request;
+    while (request.find("\r\n\r\n") == std::string::npos) {
+      char buf[1024];
+      if (request.size() >= max_request)
+        return respond(fd, "431 Request Header Fields Too Large", "");
+      ssize_t n = recv(fd, buf, sizeof(buf), 0);
+      if (n <= 0)
+        return;
+      request.append(buf, n);
+    }
+
+    // request line is: method SP target SP version
+    size_t method_end = request.find(' ');
+    size_t target_end = request.find(' ', method_end + 1);
+    if (method_end == std::string::npos || target_end == std::string::npos)
+      return respond(fd, "400 Bad Request", "");
+
+    std::string target =
+        request.substr(method_end + 1, target_end - method_end - 1);
+    target = target.substr(0, target.find('?'));
+
+    if (request.compare(0, method_end, "GET") != 0)
+      respond(fd, "405 Method Not Allowed", "");
+    else if (target != path)
+      respond(fd, "404 Not Found", "");
+    else
+      respond(fd, "200 OK", prometheus_metrics());
+  }
+
+  void respond(int fd, const char *status, const std::string &body) {
+    std::ostringstream response;
+    response << "HTTP/1.1 " << status << "\r\n"
+             << "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+             << "Content-Length: " << body.size() << "\r\n"
+             << "Connection: close\r\n\r\n"
+             << body;
+    std::string data = response.str();
+    try {
+      send_all(fd, BufferChain(Buffer(data.data(), data.size())));
+    } catch (std::runtime_error &) {
+      // the client went away
+    }
+  }
+
+  int listen_fd;
+  std::string path;
+};
+
+} // namespace ACTORPP_CONFIG_NAMESPACE
+} // namespace actorpp
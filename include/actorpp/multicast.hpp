@@ -0,0 +1,315 @@
+#pragma once
+#include "actor.hpp"
+#include "buffer.hpp"
+#include "net.hpp"
+#include "udp.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <map>
+#include <netinet/in.h>
+#include <random>
+#include <stdexcept>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+namespace actorpp {
+inline namespace ACTORPP_CONFIG_NAMESPACE {
+
+namespace detail {
+inline struct in_addr ipv4_address(const std::string &address) {
+  struct in_addr addr;
+  if (inet_pton(AF_INET, address.c_str(), &addr) != 1)
+    throw std::runtime_error("invalid IPv4 address: " + address);
+  return addr;
+}
+
+/// the header at the start of each multicast datagram: a 32 bit sender ID and
+/// a 64 bit sequence number, both big-endian
+constexpr size_t multicast_header_size = 12;
+
+inline void write_multicast_header(uint8_t *out, uint32_t sender_id,
+                                   uint64_t sequence) {
+  for (int i = 0; i < 4; i++)
+    out[i] = sender_id >> (8 * (3 - i));
+  for (int i = 0; i < 8; i++)
+    out[4 + i] = sequence >> (8 * (7 - i));
+}
+
+inline void read_multicast_header(const uint8_t *in, uint32_t &sender_id,
+                                  uint64_t &sequence) {
+  sender_id = 0;
+  for (int i = 0; i < 4; i++)
+    sender_id = (sender_id << 8) | in[i];
+  sequence = 0;
+  for (int i = 0; i < 8; i++)
+    sequence = (sequence << 8) | in[4 + i];
+}
+} // namespace detail
+
+/// create a UDP socket which receives datagrams sent to the IPv4 multicast
+/// group on port, on the interface with address interface. Many sockets (in
+/// any process) can receive from the same group and port.
+inline int bind_multicast(const std::string &group, int port,
+                          const std::string &interface = "127.0.0.1") {
+  struct ip_mreq mreq;
+  mreq.imr_multiaddr = detail::ipv4_address(group);
+  mreq.imr_interface = detail::ipv4_address(interface);
+
+  int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (sockfd < 0)
+    throw std::runtime_error("failed to allocate socket");
+
+  int one = 1;
+  setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+#ifdef SO_REUSEPORT
+  setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+#endif
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr = mreq.imr_multiaddr;
+  addr.sin_port = htons(port);
+  if (bind(sockfd, (const struct sockaddr *)&addr, sizeof(addr)) != 0) {
+    close(sockfd);
+    throw std::runtime_error("failed to bind");
+  }
+
+  if (setsockopt(sockfd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) !=
+      0) {
+    close(sockfd);
+    throw std::runtime_error("setsockopt(IP_ADD_MEMBERSHIP) failed");
+  }
+
+  return sockfd;
+}
+
+/// Sends messages to an IPv4 multicast group, with a header containing a
+/// random sender ID and a sequence number, so that receivers can detect lost
+/// messages.
+///
+/// Messages are looped back to receivers on this host (IP_MULTICAST_LOOP), and
+/// ttl limits how many routers they may cross. This is not thread-safe.
+class MulticastSender {
+public:
+  MulticastSender(const std::string &group, int port,
+                  const std::string &interface = "127.0.0.1", int ttl = 1)
+      : id(std::random_device()()), sequence(0) {
+    struct in_addr interface_addr = detail::ipv4_address(interface);
+
+    memset(&dest, 0, sizeof(dest));
+    dest.sin_family = AF_INET;
+    dest.sin_addr = detail::ipv4_address(group);
+    dest.sin_port = htons(port);
+
+    sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sockfd < 0)
+      throw std::runtime_error("failed to allocate socket");
+
+    unsigned char loop = 1, ttl_c = ttl;
+    if (setsockopt(sockfd, IPPROTO_IP, IP_MULTICAST_IF, &interface_addr,
+                   sizeof(interface_addr)) != 0 ||
+        setsockopt(sockfd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop,
+                   sizeof(loop)) != 0 ||
+        setsockopt(sockfd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl_c,
+                   sizeof(ttl_c)) != 0) {
+      close(sockfd);
+      throw std::runtime_error("failed to set multicast socket options");
+    }
+  }
+
+  ~MulticastSender() { close(sockfd); }
+
+  MulticastSender(const MulticastSender &) = delete;
+  MulticastSender &operator=(const MulticastSender &) = delete;
+
+  /// send one message
+  void send(const Buffer &message) { send(std::vector<Buffer>{message}); }
+
+  /// send several messages, using as few sendmmsg calls as possible
+  void send(const std::vector<Buffer> &messages) {
+    const size_t max_batch = 1024;
+    size_t n_batch = std::min(messages.size(), max_batch);
+    std::vector<uint8_t> headers(n_batch * detail::multicast_header_size);
+    std::vector<struct iovec> iovs(2 * n_batch);
+    std::vector<struct mmsghdr> msgs(n_batch);
+
+    size_t sent = 0;
+    while (sent < messages.size()) {
+      size_t n = std::min(messages.size() - sent, max_batch);
+      for (size_t i = 0; i < n; i++) {
+        uint8_t *header = headers.data() + i * detail::multicast_header_size;
+        detail::write_multicast_header(header, id, sequence + i);
+
+        iovs[2 * i].iov_base = header;
+        iovs[2 * i].iov_len = detail::multicast_header_size;
+        iovs[2 * i + 1].iov_base = (void *)messages[sent + i].data();
+        iovs[2 * i + 1].iov_len = messages[sent + i].size();
+
+        memset(&msgs[i], 0, sizeof(msgs[i]));
+        msgs[i].msg_hdr.msg_iov = &iovs[2 * i];
+        msgs[i].msg_hdr.msg_iovlen = 2;
+        msgs[i].msg_hdr.msg_name = &dest;
+        msgs[i].msg_hdr.msg_namelen = sizeof(dest);
+      }
+
+      int ret = sendmmsg(sockfd, msgs.data(), n, MSG_NOSIGNAL);
+      if (ret <= 0)
+        throw std::runtime_error("sendmmsg() failed");
+      sent += ret;
+      sequence += ret;
+    }
+  }
+
+  uint32_t sender_id() const { return id; }
+
+  /// the sequence number of the next message to be sent
+  uint64_t next_sequence() const { return sequence; }
+
+private:
+  int sockfd;
+  struct sockaddr_in dest;
+  uint32_t id;
+  uint64_t sequence;
+};
+
+/// a message received from a MulticastSender
+struct MulticastMessage {
+  uint32_t sender_id;
+  uint64_t sequence;
+  /// where the message was sent from
+  Address address;
+  /// the message, without the header
+  Buffer data;
+};
+
+/// reported when messages from a sender were lost
+struct MulticastGap {
+  uint32_t sender_id;
+  /// the sequence number of the first lost message
+  uint64_t first_missing;
+  /// the number of messages lost
+  uint64_t count;
+};
+
+namespace detail {
+/// Receiver which strips the multicast header from each datagram, checks the
+/// sequence number against the last received from the same sender, and pushes
+/// messages and gaps into channels. Datagrams which are too short, or which
+/// arrive after a later message from the same sender, are dropped. At most
+/// max_senders senders are tracked; beyond that, the one heard from least
+/// recently is forgotten.
+class MulticastReceiver {
+public:
+  MulticastReceiver(Channel<std::vector<MulticastMessage>> on_message,
+                    Channel<MulticastGap> on_gap, size_t batch_size,
+                    size_t max_datagram_size, size_t max_senders)
+      : on_message(std::move(on_message)), on_gap(std::move(on_gap)),
+        reader(batch_size, max_datagram_size + multicast_header_size),
+        max_senders(max_senders) {
+    if (max_senders == 0)
+      throw std::logic_error("max_senders must be at least 1");
+  }
+
+  ssize_t receive(int fd, CloseReason &reason) {
+    std::vector<Datagram> batch;
+    ssize_t bytes = reader.read(fd, batch, reason);
+
+    if (bytes < 0)
+      return bytes;
+
+    // count only the pushed messages, so that they can be passed to
+    // ByteBudget::consumed
+    std::vector<MulticastMessage> messages;
+    messages.reserve(batch.size());
+    size_t message_bytes = 0;
+    for (Datagram &datagram : batch) {
+      if (datagram.data.size() < multicast_header_size)
+        continue;
+
+      MulticastMessage message;
+      read_multicast_header(datagram.data.data(), message.sender_id,
+                            message.sequence);
+
+      auto sender = senders.find(message.sender_id);
+      if (sender != senders.end()) {
+        uint64_t next = sender->second.next_sequence;
+        if (message.sequence < next)
+          continue;
+        if (message.sequence > next)
+          on_gap.push(MulticastGap{message.sender_id, next,
+                                   message.sequence - next});
+      } else {
+        if (senders.size() >= max_senders)
+          forget_oldest_sender();
+        sender = senders.emplace(message.sender_id, SenderState()).first;
+      }
+      sender->second.next_sequence = message.sequence + 1;
+      sender->second.last_heard = ++n_accepted;
+
+      message.address = datagram.address;
+      message.data = datagram.data.slice(multicast_header_size);
+      message_bytes += message.data.size();
+      messages.push_back(std::move(message));
+    }
+
+    if (!messages.empty())
+      on_message.push(std::move(messages));
+    return message_bytes;
+  }
+
+private:
+  struct SenderState {
+    uint64_t next_sequence;
+    /// the value of n_accepted after the last message from this sender
+    uint64_t last_heard;
+  };
+
+  void forget_oldest_sender() {
+    auto oldest = std::min_element(
+        senders.begin(), senders.end(),
+        [](const std::pair<const uint32_t, SenderState> &a,
+           const std::pair<const uint32_t, SenderState> &b) {
+          return a.second.last_heard < b.second.last_heard;
+        });
+    senders.erase(oldest);
+  }
+
+  Channel<std::vector<MulticastMessage>> on_message;
+  Channel<MulticastGap> on_gap;
+  DatagramReader reader;
+  size_t max_senders;
+  std::map<uint32_t, SenderState> senders;
+  uint64_t n_accepted = 0;
+};
+} // namespace detail
+
+/// Actor which receives messages from MulticastSenders on a socket from
+/// bind_multicast, pushing batches of messages to on_message, and gaps in
+/// the sequence numbers from each sender to on_gap. The first message from
+/// each sender is accepted without reporting a gap, so receivers can join at
+/// any time. Sequence numbers are remembered for at most max_senders senders
+/// (which pick random ids, so a restarted sender is a new one); when there
+/// are more, the sender heard from least recently is forgotten, and its next
+/// message is treated as its first. budget counts the bytes in
+/// MulticastMessage::data.
+class MulticastRecvThread
+    : public detail::RecvThreadBase<detail::MulticastReceiver> {
+public:
+  MulticastRecvThread(int fd,
+                      Channel<std::vector<MulticastMessage>> on_message,
+                      Channel<MulticastGap> on_gap,
+                      Channel<CloseReason> on_close, size_t batch_size = 64,
+                      size_t max_message_size = 2048,
+                      size_t max_senders = 1024,
+                      ByteBudget budget = ByteBudget())
+      : RecvThreadBase(fd,
+                       detail::MulticastReceiver(
+                           std::move(on_message), std::move(on_gap),
+                           batch_size, max_message_size, max_senders),
+                       std::move(on_close), std::move(budget)) {}
+};
+
+} // namespace ACTORPP_CONFIG_NAMESPACE
+} // namespace actorpp
@@ -1,91 +1,359 @@
 #pragma once
 #include "actor.hpp"
+#include "buffer.hpp"
+#include "probes.hpp"
+#include <condition_variable>
+#include <limits.h>
+#include <memory>
+#include <mutex>
 #include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdint.h>
+#include <stdexcept>
 #include <string.h>
+#include <string>
+#include <sys/poll.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
+#include <vector>
+
+#if defined(ACTORPP_RECV_THREAD_EVENTFD)
+#include <sys/eventfd.h>
+#endif
 
 namespace actorpp {
+inline namespace ACTORPP_CONFIG_NAMESPACE {
 
 enum class CloseReason {
   Normal,
   Error,
 };
 
-#if !defined(ACTORPP_RECV_THREAD_SHUTDOWN) && !defined(ACTORPP_RECV_THREAD_PIPE)
-#define ACTORPP_RECV_THREAD_PIPE
+/// Socket options, applied with apply_socket_options. Options which are unset
+/// (false or -1) are left at the kernel default.
+struct SocketOptions {
+  /// TCP_NODELAY: disable Nagle's algorithm
+  bool no_delay = false;
+  /// TCP_QUICKACK: send ACKs immediately. The kernel clears this, so
+  /// RecvThread sets it again after every read
+  bool quick_ack = false;
+  /// SO_RCVBUF, in bytes
+  int recv_buffer = -1;
+  /// SO_SNDBUF, in bytes
+  int send_buffer = -1;
+  /// SO_BUSY_POLL, in microseconds; values above the net.core.busy_read sysctl
+  /// require CAP_NET_ADMIN
+  int busy_poll_us = -1;
+  /// TCP_USER_TIMEOUT, in milliseconds: how long sent data may remain
+  /// unacknowledged before the connection is closed
+  int user_timeout_ms = -1;
+  /// SO_KEEPALIVE, and TCP_KEEPIDLE, TCP_KEEPINTVL and TCP_KEEPCNT if set
+  bool keepalive = false;
+  int keepalive_idle_s = -1;
+  int keepalive_interval_s = -1;
+  int keepalive_count = -1;
+
+  /// for request/response traffic: disable Nagle and delayed ACKs, and detect
+  /// dead peers quickly
+  static SocketOptions low_latency() {
+    SocketOptions options;
+    options.no_delay = true;
+    options.quick_ack = true;
+    options.user_timeout_ms = 10000;
+    options.keepalive = true;
+    options.keepalive_idle_s = 10;
+    options.keepalive_interval_s = 2;
+    options.keepalive_count = 3;
+    return options;
+  }
+
+  /// for large transfers: large buffers, and default batching behaviour
+  static SocketOptions bulk_throughput() {
+    SocketOptions options;
+    options.recv_buffer = 4 * 1024 * 1024;
+    options.send_buffer = 4 * 1024 * 1024;
+    options.keepalive = true;
+    return options;
+  }
+};
+
+/// get a profile by name: "default", "low-latency" or "bulk-throughput"
+inline SocketOptions socket_profile(const std::string &name) {
+  if (name == "default")
+    return SocketOptions();
+  else if (name == "low-latency")
+    return SocketOptions::low_latency();
+  else if (name == "bulk-throughput")
+    return SocketOptions::bulk_throughput();
+  else
+    throw std::logic_error("unknown socket profile: " + name);
+}
+
+namespace detail {
+inline void set_socket_option(int fd, int level, int name, int value,
+                              const char *name_str) {
+  if (setsockopt(fd, level, name, &value, sizeof(value)) != 0)
+    throw std::runtime_error(std::string("setsockopt(") + name_str +
+                             ") failed");
+}
+} // namespace detail
+
+#define ACTORPP_SET_SOCKET_OPTION(fd, level, name, value)                      \
+  detail::set_socket_option(fd, level, name, value, #name)
+
+#define ACTORPP_UNSUPPORTED_SOCKET_OPTION(name)                                \
+  throw std::logic_error(#name " is not supported on this platform")
+
+/// apply options to a socket; throws if any could not be set
+inline void apply_socket_options(int fd, const SocketOptions &options) {
+  if (options.no_delay)
+    ACTORPP_SET_SOCKET_OPTION(fd, IPPROTO_TCP, TCP_NODELAY, 1);
+
+  if (options.quick_ack) {
+#ifdef TCP_QUICKACK
+    ACTORPP_SET_SOCKET_OPTION(fd, IPPROTO_TCP, TCP_QUICKACK, 1);
+#else
+    ACTORPP_UNSUPPORTED_SOCKET_OPTION(TCP_QUICKACK);
+#endif
+  }
+
+  if (options.recv_buffer >= 0)
+    ACTORPP_SET_SOCKET_OPTION(fd, SOL_SOCKET, SO_RCVBUF, options.recv_buffer);
+  if (options.send_buffer >= 0)
+    ACTORPP_SET_SOCKET_OPTION(fd, SOL_SOCKET, SO_SNDBUF, options.send_buffer);
+
+  if (options.busy_poll_us >= 0) {
+#ifdef SO_BUSY_POLL
+    ACTORPP_SET_SOCKET_OPTION(fd, SOL_SOCKET, SO_BUSY_POLL,
+                              options.busy_poll_us);
+#else
+    ACTORPP_UNSUPPORTED_SOCKET_OPTION(SO_BUSY_POLL);
 #endif
+  }
+
+  if (options.user_timeout_ms >= 0) {
+#ifdef TCP_USER_TIMEOUT
+    ACTORPP_SET_SOCKET_OPTION(fd, IPPROTO_TCP, TCP_USER_TIMEOUT,
+                              options.user_timeout_ms);
+#else
+    ACTORPP_UNSUPPORTED_SOCKET_OPTION(TCP_USER_TIMEOUT);
+#endif
+  }
+
+  if (options.keepalive) {
+    ACTORPP_SET_SOCKET_OPTION(fd, SOL_SOCKET, SO_KEEPALIVE, 1);
+    if (options.keepalive_idle_s >= 0) {
+#ifdef TCP_KEEPIDLE
+      ACTORPP_SET_SOCKET_OPTION(fd, IPPROTO_TCP, TCP_KEEPIDLE,
+                                options.keepalive_idle_s);
+#else
+      ACTORPP_UNSUPPORTED_SOCKET_OPTION(TCP_KEEPIDLE);
+#endif
+    }
+    if (options.keepalive_interval_s >= 0) {
+#ifdef TCP_KEEPINTVL
+      ACTORPP_SET_SOCKET_OPTION(fd, IPPROTO_TCP, TCP_KEEPINTVL,
+                                options.keepalive_interval_s);
+#else
+      ACTORPP_UNSUPPORTED_SOCKET_OPTION(TCP_KEEPINTVL);
+#endif
+    }
+    if (options.keepalive_count >= 0) {
+#ifdef TCP_KEEPCNT
+      ACTORPP_SET_SOCKET_OPTION(fd, IPPROTO_TCP, TCP_KEEPCNT,
+                                options.keepalive_count);
+#else
+      ACTORPP_UNSUPPORTED_SOCKET_OPTION(TCP_KEEPCNT);
+#endif
+    }
+  }
+}
+
+#undef ACTORPP_SET_SOCKET_OPTION
+#undef ACTORPP_UNSUPPORTED_SOCKET_OPTION
+
+namespace detail {
+/// apply options to fd and return it, so that they can be applied in an
+/// initialiser list before anything which would need cleaning up is created
+inline int with_socket_options(int fd, const SocketOptions &options) {
+  apply_socket_options(fd, options);
+  return fd;
+}
+
+struct ByteBudgetImpl {
+  ByteBudgetImpl(size_t high_watermark, size_t low_watermark)
+      : high_watermark(high_watermark), low_watermark(low_watermark) {}
+  const int64_t high_watermark;
+  const int64_t low_watermark;
+
+  std::mutex mut;
+  std::condition_variable cv;
+  // signed, as the consumer may report bytes before they are recorded as
+  // produced
+  int64_t outstanding = 0;
+  bool paused = false;
+  bool interrupted = false;
+};
+} // namespace detail
+
+/// Limits the number of bytes which a RecvThread has pushed but which have not
+/// yet been consumed. Once high_watermark bytes are outstanding, the
+/// RecvThread stops reading from the socket (so that the TCP window closes
+/// and the sender is slowed down), until the consumer calls consumed() enough
+/// to bring this down to low_watermark.
+///
+/// Copies share the same state; each budget must only be used by one
+/// RecvThread. A default-constructed budget is unlimited.
+class ByteBudget {
+public:
+  ByteBudget() {}
+  ByteBudget(size_t high_watermark, size_t low_watermark)
+      : impl(std::make_shared<detail::ByteBudgetImpl>(high_watermark,
+                                                      low_watermark)) {
+    if (low_watermark > high_watermark)
+      throw std::logic_error("low_watermark must not exceed high_watermark");
+  }
+
+  /// called by the consumer once n received bytes have been dealt with
+  void consumed(size_t n) {
+    if (!impl)
+      return;
+    std::unique_lock<std::mutex> lock(impl->mut);
+    impl->outstanding -= n;
+    if (impl->paused && impl->outstanding <= impl->low_watermark) {
+      impl->paused = false;
+      impl->cv.notify_all();
+    }
+  }
+
+  /// the number of bytes pushed but not consumed
+  size_t outstanding() const {
+    if (!impl)
+      return 0;
+    std::unique_lock<std::mutex> lock(impl->mut);
+    return impl->outstanding > 0 ? impl->outstanding : 0;
+  }
+
+  /// called by RecvThread once n bytes have been pushed
+  void produced(size_t n) {
+    if (!impl)
+      return;
+    std::unique_lock<std::mutex> lock(impl->mut);
+    impl->outstanding += n;
+    if (impl->outstanding >= impl->high_watermark)
+      impl->paused = true;
+  }
+
+  /// called by RecvThread before reading; blocks while paused, and returns
+  /// false if interrupt() was called
+  bool wait_for_space() {
+    if (!impl)
+      return true;
+    std::unique_lock<std::mutex> lock(impl->mut);
+    impl->cv.wait(lock, [&] { return !impl->paused || impl->interrupted; });
+    return !impl->interrupted;
+  }
+
+  /// called by RecvThread::exit to stop wait_for_space from blocking
+  void interrupt() {
+    if (!impl)
+      return;
+    std::unique_lock<std::mutex> lock(impl->mut);
+    impl->interrupted = true;
+    impl->cv.notify_all();
+  }
+
+private:
+  std::shared_ptr<detail::ByteBudgetImpl> impl;
+};
+
+namespace detail {
+
+/// Actor which reads from a socket until it is closed or exit() is called.
+/// Reading is delegated to Receiver, which must provide
+/// `ssize_t receive(int fd, CloseReason &reason)`, called whenever fd is
+/// readable, which returns the number of bytes pushed, or -1 and sets reason
+/// if the socket was closed. Reading is paused while budget is exhausted.
+template <typename Receiver> class RecvThreadBase;
 
 #if defined(ACTORPP_RECV_THREAD_SHUTDOWN)
 
-class RecvThread : Actor {
+template <typename Receiver> class RecvThreadBase : Actor {
 public:
-  RecvThread(int fd, Channel<std::vector<uint8_t>> on_message,
-             Channel<CloseReason> on_close)
-      : fd(fd), on_message(std::move(on_message)),
-        on_close(std::move(on_close)) {}
+  RecvThreadBase(int fd, Receiver receiver, Channel<CloseReason> on_close,
+                 ByteBudget budget)
+      : fd(fd), receiver(std::move(receiver)), on_close(std::move(on_close)),
+        budget(std::move(budget)) {}
   void run() {
-    while (true) {
-      std::vector<uint8_t> buf(128);
-      int bytes_read = recv(fd, buf.data(), buf.size(), 0);
-      if (bytes_read > 0) {
-        buf.resize(bytes_read);
-        on_message.push(std::move(buf));
-      } else {
-        on_close.push(CloseReason::Normal);
+    CloseReason reason = CloseReason::Normal;
+    while (budget.wait_for_space()) {
+      ssize_t bytes = receiver.receive(fd, reason);
+      ACTORPP_PROBE2(receive, fd, bytes);
+      if (bytes < 0)
         break;
-      }
+      budget.produced(bytes);
     }
+    ACTORPP_PROBE2(recv_close, fd, reason);
+    on_close.push(reason);
   }
 
-  void exit() { shutdown(fd, SHUT_RD); }
+  void exit() {
+    budget.interrupt();
+    shutdown(fd, SHUT_RD);
+  }
 
 private:
   int fd;
-  Channel<std::vector<uint8_t>> on_message;
+  Receiver receiver;
   Channel<CloseReason> on_close;
+  ByteBudget budget;
 };
 
 #elif defined(ACTORPP_RECV_THREAD_PIPE)
-#include <sys/poll.h>
 
-class RecvThread : Actor {
+template <typename Receiver> class RecvThreadBase : Actor {
 public:
-  RecvThread(int fd, Channel<std::vector<uint8_t>> on_message,
-             Channel<CloseReason> on_close)
-      : fd(fd), on_message(std::move(on_message)),
-        on_close(std::move(on_close)) {
+  RecvThreadBase(int fd, Receiver receiver, Channel<CloseReason> on_close,
+                 ByteBudget budget)
+      : fd(fd), receiver(std::move(receiver)), on_close(std::move(on_close)),
+        budget(std::move(budget)) {
     if (pipe(pipe_fds) != 0)
       throw std::runtime_error("pipe() failed");
   }
   void run() {
-    struct pollfd fds[2];
+    struct pollfd fds[2] = {};
     fds[0].fd = fd;
     fds[0].events = POLLIN;
     fds[1].fd = pipe_fds[0];
     fds[1].events = POLLIN;
-    while (true) {
+    // has the byte written by exit() been seen?
+    bool exiting = false;
+    while (budget.wait_for_space()) {
       if (poll(fds, 2, -1) <= 0)
         throw std::runtime_error("poll() failed");
-      if (fds[1].revents != 0)
+      if (fds[1].revents != 0) {
+        exiting = true;
         break;
+      }
       if (fds[0].revents & POLLIN) {
-        std::vector<uint8_t> buf(128);
-        int bytes_read = recv(fd, buf.data(), buf.size(), 0);
-        if (bytes_read > 0) {
-          buf.resize(bytes_read);
-          on_message.push(std::move(buf));
-        } else {
-          on_close.push(CloseReason::Normal);
+        CloseReason reason;
+        ssize_t bytes = receiver.receive(fd, reason);
+        ACTORPP_PROBE2(receive, fd, bytes);
+        if (bytes < 0) {
+          ACTORPP_PROBE2(recv_close, fd, reason);
+          on_close.push(reason);
           break;
         }
+        budget.produced(bytes);
       }
     }
 
     // wait for data and close the read side of the pipe; this ensures that
     // exit() never tries to write into a closed pipe
     char buf[1];
-    if (fds[1].revents == 0)
+    if (!exiting)
       if (read(pipe_fds[0], buf, 1) != 1)
         throw std::runtime_error("read(pipe fd 0) failed");
 
@@ -94,6 +362,7 @@ public:
   }
 
   void exit() {
+    budget.interrupt();
     if (pipe_fds[1]) {
       if (write(pipe_fds[1], "q", 1) != 1)
         throw std::runtime_error("write(pipe fd 1) failed");
@@ -103,48 +372,416 @@ public:
     }
   }
 
-  ~RecvThread() { exit(); }
+  ~RecvThreadBase() { exit(); }
 
 private:
   int fd;
-  Channel<std::vector<uint8_t>> on_message;
+  Receiver receiver;
   Channel<CloseReason> on_close;
+  ByteBudget budget;
   int pipe_fds[2];
 };
 
+#elif defined(ACTORPP_RECV_THREAD_EVENTFD)
+
+template <typename Receiver> class RecvThreadBase : Actor {
+public:
+  RecvThreadBase(int fd, Receiver receiver, Channel<CloseReason> on_close,
+                 ByteBudget budget)
+      : fd(fd), receiver(std::move(receiver)), on_close(std::move(on_close)),
+        budget(std::move(budget)) {
+    event_fd = eventfd(0, EFD_CLOEXEC);
+    if (event_fd < 0)
+      throw std::runtime_error("eventfd() failed");
+  }
+  void run() {
+    struct pollfd fds[2] = {};
+    fds[0].fd = fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = event_fd;
+    fds[1].events = POLLIN;
+    while (budget.wait_for_space()) {
+      if (poll(fds, 2, -1) <= 0)
+        throw std::runtime_error("poll() failed");
+      if (fds[1].revents != 0)
+        break;
+      if (fds[0].revents & POLLIN) {
+        CloseReason reason;
+        ssize_t bytes = receiver.receive(fd, reason);
+        ACTORPP_PROBE2(receive, fd, bytes);
+        if (bytes < 0) {
+          ACTORPP_PROBE2(recv_close, fd, reason);
+          on_close.push(reason);
+          break;
+        }
+        budget.produced(bytes);
+      }
+    }
+  }
+
+  // the eventfd is only closed in the destructor, so unlike the pipe
+  // implementation this can be called any number of times
+  void exit() {
+    budget.interrupt();
+    uint64_t one = 1;
+    if (write(event_fd, &one, sizeof(one)) != sizeof(one))
+      throw std::runtime_error("write(eventfd) failed");
+  }
+
+  ~RecvThreadBase() { close(event_fd); }
+
+private:
+  int fd;
+  Receiver receiver;
+  Channel<CloseReason> on_close;
+  ByteBudget budget;
+  int event_fd;
+};
+
 #else
 #error "unknown RecvThread implementation"
 #endif
 
-int connect(const std::string &hostname, int port) {
+/// set TCP_QUICKACK again after a read, since the kernel clears it
+inline void rearm_quick_ack(int fd) {
+#ifdef TCP_QUICKACK
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_QUICKACK, &one, sizeof(one));
+#else
+  (void)fd;
+#endif
+}
+
+/// Receiver which pushes chunks of bytes into a channel
+class StreamReceiver {
+public:
+  StreamReceiver(Channel<std::vector<uint8_t>> on_message,
+                 bool quick_ack = false)
+      : on_message(std::move(on_message)), quick_ack(quick_ack) {}
+
+  ssize_t receive(int fd, CloseReason &reason) {
+    std::vector<uint8_t> buf(128);
+    int bytes_read = recv(fd, buf.data(), buf.size(), 0);
+    if (bytes_read > 0) {
+      if (quick_ack)
+        rearm_quick_ack(fd);
+      buf.resize(bytes_read);
+      on_message.push(std::move(buf));
+      return bytes_read;
+    } else {
+      reason = CloseReason::Normal;
+      return -1;
+    }
+  }
+
+private:
+  Channel<std::vector<uint8_t>> on_message;
+  bool quick_ack;
+};
+
+/// Reads from a socket into large blocks, returning the received part of each
+/// block as a Buffer. Buffers share blocks, so a block is only freed once all
+/// of the buffers made from it are.
+class BlockReader {
+public:
+  static constexpr size_t block_size = 65536;
+  /// start a new block if less than this is left in the current one
+  static constexpr size_t min_read_size = 4096;
+
+  BlockReader() : used(0) {}
+
+  /// read once from fd, returning the result of recv; if this is positive,
+  /// buffer is set to the data read
+  ssize_t read(int fd, Buffer &buffer) {
+    if (!block || block->size() - used < min_read_size) {
+      block = std::make_shared<std::vector<uint8_t>>(size_t(block_size));
+      used = 0;
+    }
+
+    // only bytes after used are written; the bytes before are only read
+    // through Buffers which have already been returned
+    ssize_t bytes_read =
+        recv(fd, block->data() + used, block->size() - used, 0);
+    if (bytes_read > 0) {
+      buffer = Buffer(block, used, bytes_read);
+      used += bytes_read;
+    }
+    return bytes_read;
+  }
+
+private:
+  std::shared_ptr<std::vector<uint8_t>> block;
+  size_t used;
+};
+
+/// Receiver which pushes Buffers read by a BlockReader into a channel
+class BufferReceiver {
+public:
+  BufferReceiver(Channel<Buffer> on_message, bool quick_ack = false)
+      : on_message(std::move(on_message)), quick_ack(quick_ack) {}
+
+  ssize_t receive(int fd, CloseReason &reason) {
+    Buffer buffer;
+    ssize_t bytes_read = reader.read(fd, buffer);
+    if (bytes_read > 0) {
+      if (quick_ack)
+        rearm_quick_ack(fd);
+      on_message.push(std::move(buffer));
+      return bytes_read;
+    } else {
+      reason = CloseReason::Normal;
+      return -1;
+    }
+  }
+
+private:
+  Channel<Buffer> on_message;
+  bool quick_ack;
+  BlockReader reader;
+};
+
+} // namespace detail
+
+/// Actor which pushes data received from a socket into on_message, and pushes
+/// to on_close when the socket is closed.
+class RecvThread : public detail::RecvThreadBase<detail::StreamReceiver> {
+public:
+  /// budget may be used to limit the number of unconsumed bytes in on_message
+  RecvThread(int fd, Channel<std::vector<uint8_t>> on_message,
+             Channel<CloseReason> on_close, ByteBudget budget = ByteBudget())
+      : RecvThreadBase(fd, detail::StreamReceiver(std::move(on_message)),
+                       std::move(on_close), std::move(budget)) {}
+
+  /// apply options to fd, and keep TCP_QUICKACK set if requested
+  RecvThread(int fd, Channel<std::vector<uint8_t>> on_message,
+             Channel<CloseReason> on_close, const SocketOptions &options,
+             ByteBudget budget = ByteBudget())
+      : RecvThreadBase(detail::with_socket_options(fd, options),
+                       detail::StreamReceiver(std::move(on_message),
+                                              options.quick_ack),
+                       std::move(on_close), std::move(budget)) {}
+};
+
+/// Like RecvThread, but pushes Buffers, which are sliced from large shared
+/// blocks to avoid an allocation per read.
+class BufferRecvThread : public detail::RecvThreadBase<detail::BufferReceiver> {
+public:
+  BufferRecvThread(int fd, Channel<Buffer> on_message,
+                   Channel<CloseReason> on_close,
+                   const SocketOptions &options = SocketOptions(),
+                   ByteBudget budget = ByteBudget())
+      : RecvThreadBase(detail::with_socket_options(fd, options),
+                       detail::BufferReceiver(std::move(on_message),
+                                              options.quick_ack),
+                       std::move(on_close), std::move(budget)) {}
+};
+
+/// send all of buffers to a socket, using one sendmsg call per IOV_MAX buffers
+/// where possible
+inline void send_all(int fd, const BufferChain &buffers) {
+  const std::vector<Buffer> &parts = buffers.buffers();
+  size_t part = 0;
+  size_t part_offset = 0;
+
+  while (part < parts.size()) {
+    struct iovec iov[IOV_MAX];
+    size_t n_iov = 0;
+    for (size_t i = part; i < parts.size() && n_iov < IOV_MAX; i++) {
+      size_t offset = i == part ? part_offset : 0;
+      iov[n_iov].iov_base = (void *)(parts[i].data() + offset);
+      iov[n_iov].iov_len = parts[i].size() - offset;
+      n_iov++;
+    }
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = n_iov;
+
+    ssize_t sent = sendmsg(fd, &msg, MSG_NOSIGNAL);
+    if (sent <= 0)
+      throw std::runtime_error("sendmsg() failed");
+
+    // advance past the sent bytes
+    size_t remaining = sent;
+    while (remaining > 0) {
+      size_t left_in_part = parts[part].size() - part_offset;
+      if (remaining >= left_in_part) {
+        remaining -= left_in_part;
+        part++;
+        part_offset = 0;
+      } else {
+        part_offset += remaining;
+        remaining = 0;
+      }
+    }
+  }
+}
+
+/// a socket address, as returned by resolve()
+struct Address {
+  struct sockaddr_storage addr;
+  socklen_t addrlen;
+  int family;
+  int socktype;
+  int protocol;
+
+  /// the port number, or -1 if this is not an internet address
+  int port() const {
+    if (family == AF_INET)
+      return ntohs(((const struct sockaddr_in *)&addr)->sin_port);
+    else if (family == AF_INET6)
+      return ntohs(((const struct sockaddr_in6 *)&addr)->sin6_port);
+    else
+      return -1;
+  }
+};
+
+namespace detail {
+/// look up hostname:port with getaddrinfo, storing the results in addresses;
+/// returns the getaddrinfo error code (0 on success)
+inline int resolve(const std::string &hostname, int port,
+                   std::vector<Address> &addresses,
+                   int socktype = SOCK_STREAM) {
   struct addrinfo hints;
   memset(&hints, 0, sizeof(hints));
   hints.ai_family = AF_INET;
-  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_socktype = socktype;
   struct addrinfo *res;
 
   std::string port_str = std::to_string(port);
   int err = getaddrinfo(hostname.c_str(), port_str.c_str(), &hints, &res);
+  if (err != 0)
+    return err;
 
-  if (err != 0 || res == NULL) {
+  for (struct addrinfo *ai = res; ai != NULL; ai = ai->ai_next) {
+    Address address;
+    memcpy(&address.addr, ai->ai_addr, ai->ai_addrlen);
+    address.addrlen = ai->ai_addrlen;
+    address.family = ai->ai_family;
+    address.socktype = ai->ai_socktype;
+    address.protocol = ai->ai_protocol;
+    addresses.push_back(address);
+  }
+
+  freeaddrinfo(res);
+
+  return addresses.empty() ? EAI_NONAME : 0;
+}
+} // namespace detail
+
+/// look up the addresses for hostname:port; this blocks, see Resolver for a
+/// non-blocking alternative
+inline std::vector<Address> resolve(const std::string &hostname, int port,
+                                    int socktype = SOCK_STREAM) {
+  std::vector<Address> addresses;
+  if (detail::resolve(hostname, port, addresses, socktype) != 0)
     throw std::runtime_error("dns lookup failed");
+  return addresses;
+}
+
+/// connect to the first of addresses which accepts a connection, applying
+/// options to the socket before connecting
+inline int connect(const std::vector<Address> &addresses,
+                   const SocketOptions &options = SocketOptions()) {
+  if (addresses.empty())
+    throw std::runtime_error("dns lookup failed");
+
+  for (const Address &address : addresses) {
+    int sockfd = socket(address.family, address.socktype, address.protocol);
+    if (sockfd < 0)
+      throw std::runtime_error("failed to allocate socket");
+
+    try {
+      apply_socket_options(sockfd, options);
+    } catch (...) {
+      close(sockfd);
+      throw;
+    }
+
+    if (::connect(sockfd, (const struct sockaddr *)&address.addr,
+                  address.addrlen) == 0)
+      return sockfd;
+
+    close(sockfd);
   }
 
-  int sockfd = socket(res->ai_family, res->ai_socktype, 0);
-  if (sockfd < 0) {
-    freeaddrinfo(res);
+  throw std::runtime_error("failed to connect");
+}
+
+inline int connect(const std::string &hostname, int port,
+                   const SocketOptions &options = SocketOptions()) {
+  return connect(resolve(hostname, port), options);
+}
+
+namespace detail {
+/// create a socket bound to address, with options applied
+inline int bind_socket(const Address &address, const SocketOptions &options) {
+  int sockfd = socket(address.family, address.socktype, address.protocol);
+  if (sockfd < 0)
     throw std::runtime_error("failed to allocate socket");
+
+  int one = 1;
+  setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  try {
+    apply_socket_options(sockfd, options);
+  } catch (...) {
+    close(sockfd);
+    throw;
   }
 
-  if (connect(sockfd, res->ai_addr, res->ai_addrlen) != 0) {
+  if (bind(sockfd, (const struct sockaddr *)&address.addr, address.addrlen) !=
+      0) {
     close(sockfd);
-    freeaddrinfo(res);
-    throw std::runtime_error("failed to connect");
+    throw std::runtime_error("failed to bind");
   }
 
-  freeaddrinfo(res);
+  return sockfd;
+}
+} // namespace detail
+
+/// create a socket listening on hostname:port; port may be 0 to pick a free
+/// port, see local_port. Buffer sizes in options are inherited by accepted
+/// sockets, and must be set here to affect the negotiated window scale.
+inline int listen(const std::string &hostname, int port, int backlog = 16,
+                  const SocketOptions &options = SocketOptions()) {
+  int sockfd = detail::bind_socket(resolve(hostname, port)[0], options);
+
+  if (::listen(sockfd, backlog) != 0) {
+    close(sockfd);
+    throw std::runtime_error("failed to listen");
+  }
 
   return sockfd;
 }
 
+/// accept a connection on a socket returned by listen, applying options to
+/// the new socket
+inline int accept(int listen_fd,
+                  const SocketOptions &options = SocketOptions()) {
+  int fd = ::accept(listen_fd, NULL, NULL);
+  if (fd < 0)
+    throw std::runtime_error("failed to accept");
+
+  try {
+    apply_socket_options(fd, options);
+  } catch (...) {
+    close(fd);
+    throw;
+  }
+
+  return fd;
+}
+
+/// get the local port that a socket is bound to
+inline int local_port(int fd) {
+  struct sockaddr_in addr;
+  socklen_t addrlen = sizeof(addr);
+  if (getsockname(fd, (struct sockaddr *)&addr, &addrlen) != 0)
+    throw std::runtime_error("getsockname() failed");
+  return ntohs(addr.sin_port);
+}
+
+} // namespace ACTORPP_CONFIG_NAMESPACE
 } // namespace actorpp
@@ -0,0 +1,269 @@
+#pragma once
+#include "actor.hpp"
+#include "net.hpp"
+#include <chrono>
+#include <deque>
+#include <errno.h>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace actorpp {
+inline namespace ACTORPP_CONFIG_NAMESPACE {
+
+/// a connection handed out by ConnectionPool; return it by pushing it to
+/// ConnectionPool::release
+struct PooledConnection {
+  std::string hostname;
+  int port;
+  /// the connected socket, or -1 if connecting failed
+  int fd;
+  /// clear this before releasing if the connection must not be reused, for
+  /// example after a protocol error
+  bool reusable;
+};
+
+/// a request for a connection to hostname:port, which is pushed to reply
+struct ConnectionRequest {
+  std::string hostname;
+  int port;
+  Channel<PooledConnection> reply;
+};
+
+namespace detail {
+struct ConnectResult {
+  size_t id;
+  std::string hostname;
+  int port;
+  int fd;
+};
+
+/// opens a single connection, then exits
+class ConnectWorker : public Actor {
+public:
+  ConnectWorker(size_t id, std::string hostname, int port,
+                Channel<ConnectResult> on_result)
+      : id(id), hostname(std::move(hostname)), port(port),
+        on_result(std::move(on_result)) {}
+
+  void run() {
+    int fd;
+    try {
+      fd = connect(hostname, port);
+    } catch (const std::runtime_error &) {
+      fd = -1;
+    }
+    on_result.push(ConnectResult{id, hostname, port, fd});
+  }
+
+  void exit() {}
+
+private:
+  size_t id;
+  std::string hostname;
+  int port;
+  Channel<ConnectResult> on_result;
+};
+
+/// is an idle connection still usable? it must not have been closed by the
+/// peer, or have unexpected data waiting
+inline bool connection_healthy(int fd) {
+  char buf;
+  ssize_t ret = recv(fd, &buf, 1, MSG_PEEK | MSG_DONTWAIT);
+  return ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+} // namespace detail
+
+/// Actor which keeps connections open for reuse.
+///
+/// Connections are requested by pushing a ConnectionRequest to requests, and
+/// given back by pushing them to release. At most max_per_destination
+/// connections (in use, idle or connecting) are open to each hostname and
+/// port; further requests wait for a connection to be released.
+///
+/// Idle connections are checked every check_interval, and are closed if the
+/// peer has closed them or they have been idle for longer than idle_timeout.
+/// Idle connections are closed when the pool is destroyed; connections which
+/// are in use at that point are the responsibility of their user.
+///
+/// Releasing a connection which is not in use (for example releasing one
+/// twice) is ignored, though this can't be detected once the same fd has been
+/// handed out again.
+class ConnectionPool : public Actor {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  ConnectionPool(size_t max_per_destination = 8,
+                 Clock::duration idle_timeout = std::chrono::seconds(60),
+                 Clock::duration check_interval = std::chrono::seconds(1))
+      : requests(*this), release(*this),
+        max_per_destination(max_per_destination), idle_timeout(idle_timeout),
+        check_interval(check_interval), connected(*this), do_exit(*this) {}
+
+  ~ConnectionPool() {
+    workers.clear();
+    while (connected.readable()) {
+      detail::ConnectResult result = connected.pop();
+      if (result.fd >= 0)
+        close(result.fd);
+    }
+
+    for (auto &dest : destinations)
+      for (auto &conn : dest.second.idle)
+        close(conn.fd);
+  }
+
+  Channel<ConnectionRequest> requests;
+  Channel<PooledConnection> release;
+
+  void run() {
+    Clock::time_point next_check = Clock::now() + check_interval;
+    while (true) {
+      switch (wait_until(next_check, requests, release, connected, do_exit)) {
+      case 0:
+        on_request(requests.pop());
+        break;
+      case 1:
+        on_release(release.pop());
+        break;
+      case 2:
+        on_connected(connected.pop());
+        break;
+      case 3:
+        if (do_exit.pop())
+          return;
+        break;
+      }
+
+      Clock::time_point now = Clock::now();
+      if (now >= next_check) {
+        check_idle(now);
+        next_check = now + check_interval;
+      }
+    }
+  }
+
+  void exit() { do_exit.push(true); }
+
+private:
+  using Key = std::pair<std::string, int>;
+
+  struct IdleConnection {
+    int fd;
+    Clock::time_point since;
+  };
+
+  struct Destination {
+    std::vector<IdleConnection> idle;
+    std::deque<Channel<PooledConnection>> waiters;
+    /// the fds of connections which have been handed out
+    std::set<int> in_use;
+    size_t connecting = 0;
+
+    size_t open() const { return idle.size() + in_use.size() + connecting; }
+  };
+
+  void on_request(ConnectionRequest request) {
+    Key key(request.hostname, request.port);
+    Destination &dest = destinations[key];
+    dest.waiters.push_back(std::move(request.reply));
+    dispatch(key, dest);
+  }
+
+  void on_release(PooledConnection conn) {
+    if (conn.fd < 0)
+      return;
+
+    // ignore connections which were not handed out by this pool, or have
+    // already been released; the fd may be idle or in use by someone else, so
+    // must not be closed
+    Key key(conn.hostname, conn.port);
+    auto it = destinations.find(key);
+    if (it == destinations.end() || it->second.in_use.erase(conn.fd) == 0)
+      return;
+    Destination &dest = it->second;
+
+    if (conn.reusable && detail::connection_healthy(conn.fd))
+      dest.idle.push_back(IdleConnection{conn.fd, Clock::now()});
+    else
+      close(conn.fd);
+
+    dispatch(key, dest);
+  }
+
+  void on_connected(detail::ConnectResult result) {
+    workers.erase(result.id);
+
+    Key key(result.hostname, result.port);
+    Destination &dest = destinations[key];
+    dest.connecting--;
+
+    if (result.fd >= 0)
+      dest.idle.push_back(IdleConnection{result.fd, Clock::now()});
+    else if (dest.waiters.size() > dest.connecting) {
+      dest.waiters.front().push(
+          PooledConnection{result.hostname, result.port, -1, false});
+      dest.waiters.pop_front();
+    }
+
+    dispatch(key, dest);
+  }
+
+  /// hand idle connections to waiters, and start enough connections for the
+  /// remaining waiters, within the limit
+  void dispatch(const Key &key, Destination &dest) {
+    while (!dest.waiters.empty() && !dest.idle.empty()) {
+      IdleConnection conn = dest.idle.back();
+      dest.idle.pop_back();
+
+      if (!detail::connection_healthy(conn.fd)) {
+        close(conn.fd);
+        continue;
+      }
+
+      dest.waiters.front().push(
+          PooledConnection{key.first, key.second, conn.fd, true});
+      dest.waiters.pop_front();
+      dest.in_use.insert(conn.fd);
+    }
+
+    while (dest.waiters.size() > dest.connecting &&
+           dest.open() < max_per_destination) {
+      size_t id = next_worker_id++;
+      dest.connecting++;
+      workers[id].reset(new ActorThread<detail::ConnectWorker>(
+          id, key.first, key.second, connected));
+    }
+  }
+
+  void check_idle(Clock::time_point now) {
+    for (auto &entry : destinations) {
+      auto &idle = entry.second.idle;
+      for (auto it = idle.begin(); it != idle.end();)
+        if (now - it->since > idle_timeout ||
+            !detail::connection_healthy(it->fd)) {
+          close(it->fd);
+          it = idle.erase(it);
+        } else
+          ++it;
+    }
+  }
+
+  size_t max_per_destination;
+  Clock::duration idle_timeout;
+  Clock::duration check_interval;
+
+  std::map<Key, Destination> destinations;
+  std::map<size_t, std::unique_ptr<ActorThread<detail::ConnectWorker>>>
+      workers;
+  size_t next_worker_id = 0;
+
+  Channel<detail::ConnectResult> connected;
+  Channel<bool> do_exit;
+};
+
+} // namespace ACTORPP_CONFIG_NAMESPACE
+} // namespace actorpp
@@ -0,0 +1,120 @@
+#pragma once
+// USDT (statically defined tracing) probes, enabled by defining ACTORPP_USDT.
+//
+// These are compatible with <sys/sdt.h> (which is not required): each probe is
+// a nop instruction, with a note in the .note.stapsdt section which tells
+// tools like perf, bpftrace and systemtap where it is and where to find its
+// arguments. Tools can then replace the nop with a breakpoint while they are
+// attached, so the cost when not attached is the nop and the calculation of
+// the arguments. All arguments are passed as 8-byte integers.
+//
+// The probes in the actorpp provider are:
+//
+//   push(channel, depth, bytes): after an element is pushed to a channel;
+//     channel is the address of the channel's shared state, depth is the
+//     number of elements in it, and bytes is the size of the element if it
+//     has a size() (see ChannelStats)
+//   pop(channel, depth, bytes): before an element is popped, where depth is
+//     the number of elements which will remain
+//   wait_enter(actor): at the start of wait, wait_for, wait_until and
+//     Channel::read, where actor is the address of the actor's shared state
+//   wait_exit(actor, index): at the end of those, where index is the index
+//     of the readable channel, or -1 on timeout
+//   receive(fd, bytes): after a RecvThread reads from a socket, where bytes
+//     is the number of bytes read, or -1 if it was closed
+//   recv_close(fd, reason): when a RecvThread reports that its socket was
+//     closed, with the CloseReason
+//
+// For example, to list the probes and count pushes per channel:
+//
+//   bpftrace -l 'usdt:./program:actorpp:*'
+//   bpftrace -e 'usdt:./program:actorpp:push { @[arg0] = count(); }'
+//
+// When ACTORPP_USDT is not defined, the probe macros expand to nothing.
+
+#ifdef ACTORPP_USDT
+#if !(defined(__linux__) && (defined(__x86_64__) || defined(__aarch64__)))
+#error "ACTORPP_USDT is only supported on x86-64 and aarch64 linux"
+#endif
+
+#include <stdint.h>
+#include <type_traits>
+
+namespace actorpp {
+namespace detail {
+/// converts probe arguments to 8-byte integers; size is the argument size in
+/// the probe note, which is negative for signed values
+template <typename T, typename Enable = void> struct UsdtArg {
+  typedef typename std::conditional<std::is_signed<T>::value, int64_t,
+                                    uint64_t>::type type;
+  static constexpr int size = std::is_signed<T>::value ? -8 : 8;
+  static type get(T value) { return (type)value; }
+};
+
+template <typename T> struct UsdtArg<T *> {
+  typedef uint64_t type;
+  static constexpr int size = 8;
+  static type get(const T *value) { return (uintptr_t)value; }
+};
+} // namespace detail
+} // namespace actorpp
+
+#define ACTORPP_USDT_ARG_TYPE(x)                                               \
+  ::actorpp::detail::UsdtArg<typename std::decay<decltype(x)>::type>
+
+// the operands for argument n of a probe, named sn (size) and an (value)
+#define ACTORPP_USDT_OPERAND(n, x)                                             \
+  [s##n] "n"(ACTORPP_USDT_ARG_TYPE(x)::size),                                  \
+      [a##n] "nor"(ACTORPP_USDT_ARG_TYPE(x)::get(x))
+
+// the note describing a probe, in the format described at
+// https://sourceware.org/systemtap/wiki/UserSpaceProbeImplementation; the
+// .stapsdt.base section lets tools account for prelinking
+#define ACTORPP_USDT_NOTE(name, args)                                          \
+  "990: nop\n"                                                                 \
+  ".pushsection .note.stapsdt,\"?\",\"note\"\n"                                \
+  ".balign 4\n"                                                                \
+  ".4byte 992f-991f, 994f-993f, 3\n"                                           \
+  "991: .asciz \"stapsdt\"\n"                                                  \
+  "992: .balign 4\n"                                                           \
+  "993: .8byte 990b\n"                                                         \
+  ".8byte _.stapsdt.base\n"                                                    \
+  ".8byte 0\n"                                                                 \
+  ".asciz \"actorpp\"\n"                                                       \
+  ".asciz \"" #name "\"\n"                                                     \
+  ".asciz \"" args "\"\n"                                                      \
+  "994: .balign 4\n"                                                           \
+  ".popsection\n"                                                              \
+  ".ifndef _.stapsdt.base\n"                                                   \
+  ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n"      \
+  ".weak _.stapsdt.base\n"                                                     \
+  ".hidden _.stapsdt.base\n"                                                   \
+  "_.stapsdt.base: .space 1\n"                                                 \
+  ".size _.stapsdt.base, 1\n"                                                  \
+  ".popsection\n"                                                              \
+  ".endif\n"
+
+/// a probe named name in the actorpp provider, with one to three arguments,
+/// which may be integers, enums or pointers
+#define ACTORPP_PROBE1(name, x1)                                               \
+  __asm__ __volatile__(ACTORPP_USDT_NOTE(name, "%c[s1]@%[a1]")                 \
+                       : : ACTORPP_USDT_OPERAND(1, x1))
+
+#define ACTORPP_PROBE2(name, x1, x2)                                           \
+  __asm__ __volatile__(                                                        \
+      ACTORPP_USDT_NOTE(name, "%c[s1]@%[a1] %c[s2]@%[a2]")                     \
+      : : ACTORPP_USDT_OPERAND(1, x1), ACTORPP_USDT_OPERAND(2, x2))
+
+#define ACTORPP_PROBE3(name, x1, x2, x3)                                       \
+  __asm__ __volatile__(                                                        \
+      ACTORPP_USDT_NOTE(name, "%c[s1]@%[a1] %c[s2]@%[a2] %c[s3]@%[a3]")        \
+      : : ACTORPP_USDT_OPERAND(1, x1), ACTORPP_USDT_OPERAND(2, x2),            \
+        ACTORPP_USDT_OPERAND(3, x3))
+
+#else
+
+#define ACTORPP_PROBE1(name, x1)
+#define ACTORPP_PROBE2(name, x1, x2)
+#define ACTORPP_PROBE3(name, x1, x2, x3)
+
+#endif
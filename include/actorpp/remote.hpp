@@ -0,0 +1,484 @@
+#pragma once
+#include "actor.hpp"
+#include "buffer.hpp"
+#include "framing.hpp"
+#include "net.hpp"
+#include "serialize.hpp"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <stdint.h>
+#include <vector>
+
+namespace actorpp {
+inline namespace ACTORPP_CONFIG_NAMESPACE {
+
+/// the size of the channel ID at the start of each remote channel frame
+constexpr size_t remote_header_size = 4;
+
+/// the channel ID reserved for credit frames, so that they can share a
+/// connection with values sent in the other direction
+constexpr uint32_t remote_credit_channel_id = 0xffffffff;
+
+namespace detail {
+struct RemoteCreditImpl {
+  std::mutex mut;
+  std::condition_variable cv;
+  uint64_t messages = 0;
+  /// this may go negative, as a message is allowed if there is any byte
+  /// credit, so that messages larger than the window can still be sent
+  int64_t bytes = 0;
+  bool closed = false;
+
+  bool acquire(size_t size, bool block) {
+    std::unique_lock<std::mutex> lock(mut);
+    if (block)
+      cv.wait(lock, [&] { return closed || (messages > 0 && bytes > 0); });
+    if (closed)
+      throw std::runtime_error("remote channel closed");
+    if (messages == 0 || bytes <= 0)
+      return false;
+
+    messages--;
+    bytes -= size;
+    return true;
+  }
+
+  void grant(uint64_t n_messages, uint64_t n_bytes) {
+    std::unique_lock<std::mutex> lock(mut);
+    messages += n_messages;
+    bytes += n_bytes;
+    cv.notify_all();
+  }
+
+  void close() {
+    std::unique_lock<std::mutex> lock(mut);
+    closed = true;
+    cv.notify_all();
+  }
+};
+} // namespace detail
+
+/// The credit that the receiver of a RemoteChannel has granted to the sender,
+/// in messages and bytes of serialised data. Credit is granted by a
+/// CreditWindow at the receiving end, and received by a RemoteRecvThread (see
+/// RemoteChannels::add_credits) or a CreditRecvThread. Like Channel, copies
+/// refer to the same credit.
+class RemoteCredit {
+public:
+  RemoteCredit() : impl(std::make_shared<detail::RemoteCreditImpl>()) {}
+
+  /// take credit for one message of size bytes, returning false if there is
+  /// none (or waiting for some if block is set); throws std::runtime_error if
+  /// the connection has been closed
+  bool acquire(size_t size, bool block) { return impl->acquire(size, block); }
+
+  /// add credit for n_messages messages and n_bytes bytes
+  void grant(uint64_t n_messages, uint64_t n_bytes) {
+    impl->grant(n_messages, n_bytes);
+  }
+
+  /// wake any senders waiting for credit, and make all future attempts to
+  /// send throw
+  void close() { impl->close(); }
+
+private:
+  std::shared_ptr<detail::RemoteCreditImpl> impl;
+};
+
+/// The sending end of a channel to another process. Values pushed to this are
+/// serialised in the pushing thread, and sent as frames through a
+/// FrameSendThread, tagged with id so that the RemoteRecvThread at the other
+/// end of the connection can push them to the right local channel.
+///
+/// Many RemoteChannels (of any type) can share a FrameSendThread, and so one
+/// connection. Like Channel, copies refer to the same channel, and pushes from
+/// any thread are sent in order.
+///
+/// If constructed with a RemoteCredit, each push takes credit for one message
+/// and the size of the serialised value, so that the receiver can limit the
+/// number of messages in flight; push blocks until credit is available, while
+/// try_push fails immediately.
+///
+/// This is not a Channel, and can't be used in place of one: Channel::push
+/// never blocks or fails, and a Channel is read by a local actor, whereas
+/// pushing to a RemoteChannel may wait for credit and throws once the
+/// connection is closed, and it can only be read at the other end, through a
+/// local Channel registered with RemoteChannels. To let code which pushes to
+/// a Channel<T> send remotely, give it a Channel owned by an actor which pops
+/// from it and pushes to a RemoteChannel.
+template <typename T> class RemoteChannel {
+public:
+  RemoteChannel(Channel<BufferChain> frames, uint32_t id)
+      : frames(std::move(frames)), id(id), has_credit(false) {}
+
+  RemoteChannel(Channel<BufferChain> frames, uint32_t id, RemoteCredit credit)
+      : frames(std::move(frames)), id(id), credit(std::move(credit)),
+        has_credit(true) {}
+
+  void push(const T &value) { push(value, true); }
+
+  /// push if there is enough credit, returning false otherwise
+  bool try_push(const T &value) { return push(value, false); }
+
+  uint32_t channel_id() const { return id; }
+
+private:
+  bool push(const T &value, bool block) {
+    std::vector<uint8_t> data(remote_header_size);
+    detail::write_be32(data.data(), id);
+    Serializer<T>::write(value, data);
+
+    if (has_credit && !credit.acquire(data.size() - remote_header_size, block))
+      return false;
+
+    frames.push(BufferChain(Buffer(std::move(data))));
+    return true;
+  }
+
+  Channel<BufferChain> frames;
+  uint32_t id;
+  RemoteCredit credit;
+  bool has_credit;
+};
+
+/// the size of each credit frame: remote_credit_channel_id, then the 32 bit
+/// ID of the channel the credit is for, a 32 bit message count and a 64 bit
+/// byte count, all big-endian
+constexpr size_t credit_frame_size = remote_header_size + 16;
+
+namespace detail {
+inline void write_be64(uint8_t *out, uint64_t value) {
+  write_be32(out, value >> 32);
+  write_be32(out + 4, value);
+}
+
+inline uint64_t read_be64(const uint8_t *in) {
+  return (uint64_t(read_be32(in)) << 32) | read_be32(in + 4);
+}
+
+struct CreditWindowImpl {
+  CreditWindowImpl(Channel<BufferChain> frames, uint32_t id,
+                   uint32_t max_messages, uint64_t max_bytes)
+      : frames(std::move(frames)), id(id), max_messages(max_messages),
+        max_bytes(max_bytes) {}
+
+  std::mutex mut;
+  Channel<BufferChain> frames;
+  uint32_t id;
+  uint32_t max_messages;
+  uint64_t max_bytes;
+
+  /// the sizes of messages received but not consumed
+  std::deque<size_t> sizes;
+  uint64_t outstanding_bytes = 0;
+  /// credit for consumed messages which has not been sent yet
+  uint32_t ungranted_messages = 0;
+  uint64_t ungranted_bytes = 0;
+
+  void send_grant(uint32_t n_messages, uint64_t n_bytes) {
+    std::vector<uint8_t> data(credit_frame_size);
+    write_be32(data.data(), remote_credit_channel_id);
+    write_be32(data.data() + 4, id);
+    write_be32(data.data() + 8, n_messages);
+    write_be64(data.data() + 12, n_bytes);
+    frames.push(BufferChain(Buffer(std::move(data))));
+  }
+
+  bool received(size_t size) {
+    std::unique_lock<std::mutex> lock(mut);
+    // a well-behaved sender never goes over the window; messages are allowed
+    // while any byte credit remains
+    if (sizes.size() + ungranted_messages >= max_messages ||
+        outstanding_bytes + ungranted_bytes >= max_bytes)
+      return false;
+
+    sizes.push_back(size);
+    outstanding_bytes += size;
+    return true;
+  }
+
+  void consumed(size_t n) {
+    std::unique_lock<std::mutex> lock(mut);
+    if (n > sizes.size())
+      throw std::logic_error("consumed more messages than were received");
+
+    for (size_t i = 0; i < n; i++) {
+      outstanding_bytes -= sizes.front();
+      ungranted_bytes += sizes.front();
+      sizes.pop_front();
+    }
+    ungranted_messages += n;
+
+    // grant in batches of at least half of the window, to limit the number
+    // of credit frames
+    if (ungranted_messages >= (max_messages + 1) / 2 ||
+        ungranted_bytes >= (max_bytes + 1) / 2) {
+      send_grant(ungranted_messages, ungranted_bytes);
+      ungranted_messages = 0;
+      ungranted_bytes = 0;
+    }
+  }
+};
+} // namespace detail
+
+/// The receiving end of flow control for a RemoteChannel. This allows the
+/// sender to have up to max_messages messages and max_bytes bytes of
+/// serialised data received but not consumed, by sending credit frames through
+/// a FrameSendThread on the receiving end of the connection; this may be the
+/// same FrameSendThread as is used for RemoteChannels in the other direction.
+/// The initial credit is sent on construction.
+///
+/// Pass this to RemoteChannels::add, and call consumed() once messages have
+/// been popped from the local channel. Like Channel, copies refer to the same
+/// window.
+class CreditWindow {
+public:
+  CreditWindow(Channel<BufferChain> frames, uint32_t id, uint32_t max_messages,
+               uint64_t max_bytes)
+      : impl(std::make_shared<detail::CreditWindowImpl>(
+            std::move(frames), id, max_messages, max_bytes)) {
+    if (max_messages == 0 || max_bytes == 0)
+      throw std::logic_error("CreditWindow must allow some messages");
+    if (id == remote_credit_channel_id)
+      throw std::logic_error("remote channel ID is reserved");
+    impl->send_grant(max_messages, max_bytes);
+  }
+
+  /// called by the RemoteRecvThread for each message received; returns false
+  /// if the sender has gone over the window
+  bool received(size_t size) { return impl->received(size); }
+
+  /// return credit for n messages which have been taken from the channel
+  void consumed(size_t n = 1) { impl->consumed(n); }
+
+  uint32_t channel_id() const { return impl->id; }
+
+private:
+  std::shared_ptr<detail::CreditWindowImpl> impl;
+};
+
+/// The sending end of flow control for a connection: the RemoteCredit for each
+/// channel ID, which is updated by the RemoteRecvThread it was passed to with
+/// RemoteChannels::add_credits, or by a CreditRecvThread. Add all channels
+/// before starting the thread.
+class RemoteCredits {
+public:
+  /// get the credit for channel ID id, to be passed to RemoteChannel
+  RemoteCredit add(uint32_t id) {
+    if (id == remote_credit_channel_id)
+      throw std::logic_error("remote channel ID is reserved");
+    if (credits.count(id))
+      throw std::logic_error("remote channel ID already used");
+    return credits[id];
+  }
+
+  /// apply a credit frame; returns false if it is invalid
+  bool grant(const Buffer &frame) {
+    if (frame.size() != credit_frame_size ||
+        detail::read_be32(frame.data()) != remote_credit_channel_id)
+      return false;
+    auto credit = credits.find(detail::read_be32(frame.data() + 4));
+    if (credit == credits.end())
+      return false;
+    credit->second.grant(detail::read_be32(frame.data() + 8),
+                         detail::read_be64(frame.data() + 12));
+    return true;
+  }
+
+  /// close all credits
+  void close() {
+    for (auto &credit : credits)
+      credit.second.close();
+  }
+
+private:
+  std::map<uint32_t, RemoteCredit> credits;
+};
+
+/// The local channels which values received by a RemoteRecvThread are pushed
+/// to, by channel ID, and the credits which credit frames received with them
+/// are applied to. Add all channels before starting the RemoteRecvThread.
+class RemoteChannels {
+public:
+  /// push values received for channel ID id to channel
+  template <typename T> void add(uint32_t id, Channel<T> channel) {
+    if (id == remote_credit_channel_id)
+      throw std::logic_error("remote channel ID is reserved");
+    if (decoders.count(id))
+      throw std::logic_error("remote channel ID already used");
+
+    decoders[id] = [channel](const Buffer &data) mutable {
+      T value;
+      if (!Serializer<T>::read(data, value))
+        return false;
+      channel.push(std::move(value));
+      return true;
+    };
+  }
+
+  /// push values received for the window's channel ID to channel, closing the
+  /// connection if the sender does not respect the window
+  template <typename T> void add(Channel<T> channel, CreditWindow window) {
+    uint32_t id = window.channel_id();
+    add(id, channel);
+
+    std::function<bool(const Buffer &)> decode = std::move(decoders[id]);
+    decoders[id] = [decode, window](const Buffer &data) mutable {
+      return window.received(data.size()) && decode(data);
+    };
+  }
+
+  /// apply credit frames received on this connection to credits, so that
+  /// RemoteChannels sending in the other direction over the same connection
+  /// can use flow control; the credits are closed when the RemoteRecvThread's
+  /// connection closes or it exits
+  void add_credits(RemoteCredits credits) {
+    this->credits = std::move(credits);
+  }
+
+  /// decode a frame and push it to the channel it is for, or apply a credit
+  /// frame; returns false if the channel is not known or the value can not be
+  /// decoded
+  bool dispatch(const Buffer &frame) {
+    if (frame.size() < remote_header_size)
+      return false;
+    uint32_t id = detail::read_be32(frame.data());
+    if (id == remote_credit_channel_id)
+      return credits.grant(frame);
+    auto decoder = decoders.find(id);
+    if (decoder == decoders.end())
+      return false;
+    return decoder->second(frame.slice(remote_header_size));
+  }
+
+  /// close the credits passed to add_credits
+  void close_credits() { credits.close(); }
+
+private:
+  std::map<uint32_t, std::function<bool(const Buffer &)>> decoders;
+  RemoteCredits credits;
+};
+
+namespace detail {
+/// FrameReceiver handler which dispatches frames to remote channels
+struct DispatchFrame {
+  RemoteChannels channels;
+
+  bool operator()(Buffer frame) { return channels.dispatch(frame); }
+};
+
+/// Receiver which dispatches frames to remote channels, and closes their
+/// credits when the connection closes, so that senders don't wait forever
+class RemoteReceiver {
+public:
+  RemoteReceiver(RemoteChannels channels, size_t max_frame_size,
+                 FrameChecksum checksum)
+      : channels(channels),
+        frames(DispatchFrame{channels}, max_frame_size, checksum) {}
+
+  ssize_t receive(int fd, CloseReason &reason) {
+    ssize_t bytes = frames.receive(fd, reason);
+    if (bytes < 0)
+      channels.close_credits();
+    return bytes;
+  }
+
+private:
+  RemoteChannels channels;
+  FrameReceiver<DispatchFrame> frames;
+};
+} // namespace detail
+
+/// Actor which reads frames sent by RemoteChannels from a stream socket, and
+/// pushes the decoded values to the corresponding channels in `channels`.
+/// Credit frames sent by CreditWindows at the other end are applied to the
+/// credits passed to RemoteChannels::add_credits, so one connection can carry
+/// flow-controlled channels in both directions.
+///
+/// on_close is pushed CloseReason::Normal when the socket is closed, and
+/// CloseReason::Error if the stream is corrupt or fails a checksum, or a frame
+/// is for an unknown channel or can not be decoded; in these cases no more
+/// values are received. When the connection is closed or this exits, the
+/// credits are closed, so pushes to the corresponding RemoteChannels throw
+/// rather than blocking.
+class RemoteRecvThread
+    : public detail::RecvThreadBase<detail::RemoteReceiver> {
+public:
+  RemoteRecvThread(int fd, RemoteChannels channels,
+                   Channel<CloseReason> on_close,
+                   size_t max_frame_size = 16 * 1024 * 1024,
+                   FrameChecksum checksum = FrameChecksum::None,
+                   ByteBudget budget = ByteBudget())
+      : RecvThreadBase(fd,
+                       detail::RemoteReceiver(channels, max_frame_size,
+                                              checksum),
+                       std::move(on_close), std::move(budget)),
+        channels(channels) {}
+
+  ~RemoteRecvThread() { channels.close_credits(); }
+
+private:
+  RemoteChannels channels;
+};
+
+namespace detail {
+/// FrameReceiver handler which applies credit frames
+struct GrantFrame {
+  RemoteCredits credits;
+
+  bool operator()(Buffer frame) { return credits.grant(frame); }
+};
+
+/// Receiver which reads credit frames, and closes the credits when the
+/// connection closes, so that senders don't wait forever
+class CreditReceiver {
+public:
+  CreditReceiver(RemoteCredits credits, FrameChecksum checksum)
+      : credits(credits),
+        frames(GrantFrame{credits}, credit_frame_size, checksum) {}
+
+  ssize_t receive(int fd, CloseReason &reason) {
+    ssize_t bytes = frames.receive(fd, reason);
+    if (bytes < 0)
+      credits.close();
+    return bytes;
+  }
+
+private:
+  RemoteCredits credits;
+  FrameReceiver<GrantFrame> frames;
+};
+} // namespace detail
+
+/// Actor which reads credit frames sent by CreditWindows from the sending end
+/// of a connection, and adds them to the RemoteCredits used by RemoteChannels.
+/// This is for connections which only carry values in one direction; where
+/// the sending end also runs a RemoteRecvThread on the connection, pass the
+/// credits to RemoteChannels::add_credits instead, as only one thread can
+/// read from it.
+///
+/// When the connection is closed or this exits, all of the credits are closed,
+/// so pushes to the corresponding RemoteChannels throw rather than blocking.
+class CreditRecvThread
+    : public detail::RecvThreadBase<detail::CreditReceiver> {
+public:
+  CreditRecvThread(int fd, RemoteCredits credits,
+                   Channel<CloseReason> on_close,
+                   FrameChecksum checksum = FrameChecksum::None)
+      : RecvThreadBase(fd, detail::CreditReceiver(credits, checksum),
+                       std::move(on_close), ByteBudget()),
+        credits(credits) {}
+
+  ~CreditRecvThread() { credits.close(); }
+
+private:
+  RemoteCredits credits;
+};
+
+} // namespace ACTORPP_CONFIG_NAMESPACE
+} // namespace actorpp
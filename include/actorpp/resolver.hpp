@@ -0,0 +1,164 @@
+#pragma once
+#include "actor.hpp"
+#include "net.hpp"
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace actorpp {
+inline namespace ACTORPP_CONFIG_NAMESPACE {
+
+/// the result of a lookup performed by Resolver
+struct ResolveResult {
+  std::string hostname;
+  int port;
+  /// 0 on success, otherwise a getaddrinfo error code (see gai_strerror)
+  int error;
+  std::vector<Address> addresses;
+};
+
+/// a request for Resolver to look up hostname:port; the result is pushed to
+/// reply
+struct ResolveRequest {
+  std::string hostname;
+  int port;
+  Channel<ResolveResult> reply;
+};
+
+namespace detail {
+/// performs a single blocking lookup, then exits
+class ResolveWorker : public Actor {
+public:
+  ResolveWorker(std::string hostname, int port,
+                Channel<ResolveResult> on_result)
+      : hostname(std::move(hostname)), port(port),
+        on_result(std::move(on_result)) {}
+
+  void run() {
+    ResolveResult result{hostname, port, 0, {}};
+    result.error = detail::resolve(hostname, port, result.addresses);
+    on_result.push(std::move(result));
+  }
+
+  void exit() {}
+
+private:
+  std::string hostname;
+  int port;
+  Channel<ResolveResult> on_result;
+};
+} // namespace detail
+
+/// Actor which performs DNS lookups in worker threads, so that requesters are
+/// never blocked by getaddrinfo.
+///
+/// Concurrent requests for the same hostname and port share one lookup, and
+/// results are cached for ttl (or negative_ttl for failures); getaddrinfo does
+/// not expose record TTLs, so these should be set to match the records being
+/// looked up.
+class Resolver : public Actor {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  Resolver(Clock::duration ttl = std::chrono::seconds(60),
+           Clock::duration negative_ttl = std::chrono::seconds(5))
+      : requests(*this), ttl(ttl), negative_ttl(negative_ttl),
+        results(*this), do_exit(*this) {}
+
+  Channel<ResolveRequest> requests;
+
+  /// the number of getaddrinfo calls that have been started
+  size_t lookup_count() const { return lookups; }
+
+  void run() {
+    while (true) {
+      switch (wait(requests, results, do_exit)) {
+      case 0:
+        on_request(requests.pop());
+        break;
+      case 1:
+        on_result(results.pop());
+        break;
+      case 2:
+        if (do_exit.pop())
+          return;
+        break;
+      }
+    }
+  }
+
+  void exit() { do_exit.push(true); }
+
+private:
+  using Key = std::pair<std::string, int>;
+
+  struct CacheEntry {
+    ResolveResult result;
+    Clock::time_point expiry;
+  };
+
+  struct Lookup {
+    std::vector<Channel<ResolveResult>> waiters;
+    std::unique_ptr<ActorThread<detail::ResolveWorker>> worker;
+  };
+
+  void on_request(ResolveRequest request) {
+    Key key(request.hostname, request.port);
+
+    auto cached = cache.find(key);
+    if (cached != cache.end()) {
+      if (Clock::now() < cached->second.expiry) {
+        request.reply.push(cached->second.result);
+        return;
+      }
+      cache.erase(cached);
+    }
+
+    auto pending = lookups_in_progress.find(key);
+    if (pending != lookups_in_progress.end()) {
+      pending->second.waiters.push_back(std::move(request.reply));
+      return;
+    }
+
+    Lookup &lookup = lookups_in_progress[key];
+    lookup.waiters.push_back(std::move(request.reply));
+    lookups++;
+    lookup.worker.reset(new ActorThread<detail::ResolveWorker>(
+        request.hostname, request.port, results));
+  }
+
+  void on_result(ResolveResult result) {
+    Clock::time_point now = Clock::now();
+    for (auto it = cache.begin(); it != cache.end();)
+      if (it->second.expiry <= now)
+        it = cache.erase(it);
+      else
+        ++it;
+
+    Key key(result.hostname, result.port);
+    auto pending = lookups_in_progress.find(key);
+    for (auto &waiter : pending->second.waiters)
+      waiter.push(result);
+    lookups_in_progress.erase(pending);
+
+    Clock::duration entry_ttl = result.error == 0 ? ttl : negative_ttl;
+    cache[key] = CacheEntry{std::move(result), now + entry_ttl};
+  }
+
+  Clock::duration ttl;
+  Clock::duration negative_ttl;
+
+  std::map<Key, CacheEntry> cache;
+  std::map<Key, Lookup> lookups_in_progress;
+  std::atomic<size_t> lookups{0};
+
+  Channel<ResolveResult> results;
+  Channel<bool> do_exit;
+};
+
+} // namespace ACTORPP_CONFIG_NAMESPACE
+} // namespace actorpp
@@ -0,0 +1,187 @@
+#pragma once
+#include "buffer.hpp"
+#include <algorithm>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace actorpp {
+
+namespace detail {
+/// reverse the bytes of each of the n Size-byte values at data
+template <size_t Size> inline void swap_bytes(uint8_t *data, size_t n) {
+  for (size_t i = 0; i < n; i++)
+    std::reverse(data + i * Size, data + (i + 1) * Size);
+}
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+constexpr bool host_big_endian = true;
+#else
+constexpr bool host_big_endian = false;
+#endif
+} // namespace detail
+
+/// Converts n values of type T between host byte order and the opposite byte
+/// order, in place. This is provided for arithmetic and enum types; to send
+/// trivially copyable structs from big-endian hosts, specialise this to swap
+/// each field, for example with ByteSwap<int32_t>::swap(&value.x, 1).
+template <typename T, typename Enable = void> struct ByteSwap;
+
+template <typename T>
+struct ByteSwap<T, typename std::enable_if<std::is_arithmetic<T>::value ||
+                                           std::is_enum<T>::value>::type> {
+  static void swap(T *values, size_t n) {
+    detail::swap_bytes<sizeof(T)>((uint8_t *)values, n);
+  }
+};
+
+namespace detail {
+typedef std::integral_constant<bool, host_big_endian> host_big_endian_t;
+
+/// append n values to out in wire byte order (little-endian)
+template <typename T>
+inline void write_trivial(const T *values, size_t n, std::vector<uint8_t> &out,
+                          std::false_type /* big endian */) {
+  out.insert(out.end(), (const uint8_t *)values,
+             (const uint8_t *)(values + n));
+}
+
+template <typename T>
+inline void write_trivial(const T *values, size_t n, std::vector<uint8_t> &out,
+                          std::true_type /* big endian */) {
+  std::vector<T> swapped(values, values + n);
+  ByteSwap<T>::swap(swapped.data(), n);
+  write_trivial(swapped.data(), n, out, std::false_type());
+}
+
+template <typename T>
+inline void write_trivial(const T *values, size_t n,
+                          std::vector<uint8_t> &out) {
+  write_trivial(values, n, out, host_big_endian_t());
+}
+
+/// read n values in wire byte order from data
+template <typename T>
+inline void read_trivial(const uint8_t *data, size_t n, T *values,
+                         std::false_type /* big endian */) {
+  if (n)
+    memcpy((void *)values, data, n * sizeof(T));
+}
+
+template <typename T>
+inline void read_trivial(const uint8_t *data, size_t n, T *values,
+                         std::true_type /* big endian */) {
+  read_trivial(data, n, values, std::false_type());
+  ByteSwap<T>::swap(values, n);
+}
+
+template <typename T>
+inline void read_trivial(const uint8_t *data, size_t n, T *values) {
+  read_trivial(data, n, values, host_big_endian_t());
+}
+} // namespace detail
+
+/// Converts values of type T to and from bytes, for sending to RemoteChannels.
+/// Specialisations have members:
+///
+///   static void write(const T &value, std::vector<uint8_t> &out);
+///   static bool read(const Buffer &data, T &value);
+///
+/// write appends the encoding of value to out. read decodes all of data into
+/// value, returning false if data is not a valid encoding.
+///
+/// Arithmetic and enum types, structs which are MemcpySerializable, and
+/// vectors of these, are copied as they are in memory, in little-endian byte
+/// order, so sending a vector of plain structs costs about one memcpy at each
+/// end. Specialise this for other types.
+template <typename T, typename Enable = void> struct Serializer;
+
+/// Specialise this as std::true_type for a trivially copyable struct to
+/// serialise it (and vectors of it) by copying its bytes. Only do this for
+/// structs which have no padding (add explicit reserved fields to fill any
+/// gaps) and no pointer members, and which both ends lay out in the same way:
+/// padding bytes would be sent as they are, leaking whatever was in memory,
+/// and pointers are meaningless in the receiving process.
+///
+/// When the standard library has std::has_unique_object_representations
+/// (C++17), structs without padding are detected automatically, apart from
+/// those with floating-point members, which must still opt in. Pointer
+/// members are not detected.
+template <typename T> struct MemcpySerializable : std::false_type {};
+
+namespace detail {
+/// is T free of padding bytes, as far as can be detected?
+template <typename T>
+struct has_no_padding
+#ifdef __cpp_lib_has_unique_object_representations
+    : std::has_unique_object_representations<T> {
+#else
+    : std::false_type {
+#endif
+};
+
+/// can T be serialised by copying its bytes?
+template <typename T>
+struct is_memcpy_serializable
+    : std::integral_constant<
+          bool, std::is_trivially_copyable<T>::value &&
+                    !std::is_pointer<T>::value &&
+                    !std::is_member_pointer<T>::value &&
+                    (std::is_arithmetic<T>::value || std::is_enum<T>::value ||
+                     MemcpySerializable<T>::value ||
+                     has_no_padding<T>::value)> {};
+} // namespace detail
+
+template <typename T>
+struct Serializer<T, typename std::enable_if<
+                         detail::is_memcpy_serializable<T>::value>::type> {
+  static void write(const T &value, std::vector<uint8_t> &out) {
+    detail::write_trivial(&value, 1, out);
+  }
+  static bool read(const Buffer &data, T &value) {
+    if (data.size() != sizeof(T))
+      return false;
+    detail::read_trivial(data.data(), 1, &value);
+    return true;
+  }
+};
+
+template <typename T>
+struct Serializer<
+    std::vector<T>,
+    typename std::enable_if<detail::is_memcpy_serializable<T>::value>::type> {
+  static void write(const std::vector<T> &value, std::vector<uint8_t> &out) {
+    detail::write_trivial(value.data(), value.size(), out);
+  }
+  static bool read(const Buffer &data, std::vector<T> &value) {
+    if (data.size() % sizeof(T) != 0)
+      return false;
+    value.resize(data.size() / sizeof(T));
+    detail::read_trivial(data.data(), value.size(), value.data());
+    return true;
+  }
+};
+
+template <> struct Serializer<std::string> {
+  static void write(const std::string &value, std::vector<uint8_t> &out) {
+    out.insert(out.end(), value.begin(), value.end());
+  }
+  static bool read(const Buffer &data, std::string &value) {
+    value.assign(data.begin(), data.end());
+    return true;
+  }
+};
+
+template <> struct Serializer<Buffer> {
+  static void write(const Buffer &value, std::vector<uint8_t> &out) {
+    out.insert(out.end(), value.begin(), value.end());
+  }
+  static bool read(const Buffer &data, Buffer &value) {
+    value = data;
+    return true;
+  }
+};
+
+} // namespace actorpp
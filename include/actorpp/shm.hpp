@@ -0,0 +1,353 @@
+#pragma once
+#include "actor.hpp"
+#include <atomic>
+#include <climits>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <memory>
+#include <new>
+#include <pthread.h>
+#include <stdexcept>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <type_traits>
+#include <unistd.h>
+
+namespace actorpp {
+inline namespace ACTORPP_CONFIG_NAMESPACE {
+
+namespace detail {
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) &&
+                  ATOMIC_INT_LOCK_FREE == 2,
+              "futexes require plain 32 bit atomics");
+
+inline void futex_wait(std::atomic<uint32_t> &word, uint32_t value) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT, value,
+          NULL, NULL, 0);
+}
+
+inline void futex_wake(std::atomic<uint32_t> &word, int count = INT_MAX) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE, count,
+          NULL, NULL, 0);
+}
+
+/// initialise a mutex in shared memory, which is robust so that it is
+/// released if a process dies while holding it
+inline void init_robust_mutex(pthread_mutex_t &mut) {
+  pthread_mutexattr_t attr;
+  if (pthread_mutexattr_init(&attr) != 0)
+    throw std::runtime_error("pthread_mutexattr_init() failed");
+  int ret = pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+  if (ret == 0)
+    ret = pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+  if (ret == 0)
+    ret = pthread_mutex_init(&mut, &attr);
+  pthread_mutexattr_destroy(&attr);
+  if (ret != 0)
+    throw std::runtime_error("pthread_mutex_init() failed");
+}
+
+/// lock a mutex made by init_robust_mutex. If its owner died while holding
+/// it, the lock is taken over: the state it protects is only changed by
+/// single stores, so it is still consistent
+inline void robust_lock(pthread_mutex_t &mut) {
+  int ret = pthread_mutex_lock(&mut);
+  if (ret == EOWNERDEAD)
+    ret = pthread_mutex_consistent(&mut);
+  if (ret != 0)
+    throw std::runtime_error("pthread_mutex_lock() failed");
+}
+
+/// like robust_lock, but returns false rather than blocking if the mutex is
+/// held by someone else
+inline bool robust_try_lock(pthread_mutex_t &mut) {
+  int ret = pthread_mutex_trylock(&mut);
+  if (ret == EBUSY)
+    return false;
+  if (ret == EOWNERDEAD)
+    ret = pthread_mutex_consistent(&mut);
+  if (ret != 0)
+    throw std::runtime_error("pthread_mutex_trylock() failed");
+  return true;
+}
+
+inline void robust_unlock(pthread_mutex_t &mut) { pthread_mutex_unlock(&mut); }
+
+/// the immutable part of ShmChannelHeader
+struct ShmChannelInfo {
+  static constexpr uint32_t magic_value = 0x61637070;
+
+  uint32_t magic;
+  uint32_t element_size;
+  uint32_t capacity;
+};
+
+/// the start of the shared memory region behind a ShmChannel. head and tail
+/// are free-running indices; the capacity is a power of two, so they index
+/// the slots modulo capacity. The *_seq words are futexes which are
+/// incremented to wake waiters.
+struct ShmChannelHeader {
+  ShmChannelInfo info;
+
+  // written by writers
+  alignas(64) std::atomic<uint32_t> head;
+  std::atomic<uint32_t> reader_waiting;
+  std::atomic<uint32_t> data_seq;
+
+  // written by the reader
+  alignas(64) std::atomic<uint32_t> tail;
+  std::atomic<uint32_t> writers_waiting;
+  std::atomic<uint32_t> space_seq;
+
+  // held by writers while writing a slot and head; not held while waiting
+  // for space
+  alignas(64) pthread_mutex_t write_lock;
+};
+
+/// an mmapped region, which is unmapped and closed on destruction
+struct ShmMapping {
+  ShmMapping(int fd, size_t size) : fd(fd), size(size) {
+    addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+      close(fd);
+      throw std::runtime_error("mmap() failed");
+    }
+  }
+
+  ~ShmMapping() {
+    munmap(addr, size);
+    close(fd);
+  }
+
+  int fd;
+  size_t size;
+  void *addr;
+};
+} // namespace detail
+
+/// A bounded channel in shared memory, which can be used to send
+/// trivially-copyable values between processes.
+///
+/// Create one with create(), pass fd() to another process (by inheritance, or
+/// with send_message in unix.hpp), and open it there with attach(). Any number
+/// of threads in any process may push, but only one thread may read; to wait
+/// for data alongside other channels, use ShmRecvThread.
+///
+/// If a process dies while pushing, the element it was pushing may be lost,
+/// but other processes can carry on using the channel.
+template <typename T> class ShmChannel {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "ShmChannel can only hold trivially-copyable types");
+
+public:
+  using type = T;
+
+  /// make a new channel with space for at least capacity elements
+  static ShmChannel create(size_t capacity) {
+    uint32_t rounded = 1;
+    while (rounded < capacity) {
+      if (rounded >= (1u << 31))
+        throw std::logic_error("ShmChannel capacity too large");
+      rounded <<= 1;
+    }
+
+    int fd = memfd_create("actorpp_shm_channel", MFD_CLOEXEC);
+    if (fd < 0)
+      throw std::runtime_error("memfd_create() failed");
+
+    size_t size = data_offset() + rounded * sizeof(T);
+    if (ftruncate(fd, size) != 0) {
+      close(fd);
+      throw std::runtime_error("ftruncate() failed");
+    }
+
+    ShmChannel chan(std::make_shared<detail::ShmMapping>(fd, size));
+    detail::ShmChannelHeader *header =
+        new (chan.mapping->addr) detail::ShmChannelHeader();
+    header->info.magic = detail::ShmChannelInfo::magic_value;
+    header->info.element_size = sizeof(T);
+    header->info.capacity = rounded;
+    detail::init_robust_mutex(header->write_lock);
+    chan.header = header;
+    chan.slots = chan.slots_for(header);
+    return chan;
+  }
+
+  /// open a channel from the fd of one made with create(); fd is not closed
+  static ShmChannel attach(int fd) {
+    detail::ShmChannelInfo info;
+    if (pread(fd, &info, sizeof(info), 0) != sizeof(info))
+      throw std::runtime_error("failed to read ShmChannel header");
+    if (info.magic != detail::ShmChannelInfo::magic_value ||
+        info.element_size != sizeof(T) || info.capacity == 0 ||
+        (info.capacity & (info.capacity - 1)) != 0)
+      throw std::runtime_error("fd is not a compatible ShmChannel");
+
+    // mapping past the end of the file would cause SIGBUS on access
+    size_t size = data_offset() + info.capacity * sizeof(T);
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+      throw std::runtime_error("fstat() failed");
+    if ((uint64_t)st.st_size < size)
+      throw std::runtime_error("ShmChannel fd is too small");
+
+    int own_fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (own_fd < 0)
+      throw std::runtime_error("fcntl(F_DUPFD_CLOEXEC) failed");
+
+    ShmChannel chan(std::make_shared<detail::ShmMapping>(own_fd, size));
+    chan.header =
+        reinterpret_cast<detail::ShmChannelHeader *>(chan.mapping->addr);
+    chan.slots = chan.slots_for(chan.header);
+    return chan;
+  }
+
+  /// the shared memory file descriptor, to be passed to attach()
+  int fd() const { return mapping->fd; }
+
+  /// the number of elements which can be held
+  size_t capacity() const { return header->info.capacity; }
+
+  /// push an element, blocking while the channel is full
+  void push(const T &item) {
+    while (true) {
+      detail::robust_lock(header->write_lock);
+      uint32_t head = header->head.load(std::memory_order_relaxed);
+      if (head - header->tail.load() != header->info.capacity) {
+        write_with_lock(head, item);
+        return;
+      }
+
+      // wait for space without the lock, so that other writers are not
+      // blocked; head and tail are checked again once it is re-taken
+      header->writers_waiting.fetch_add(1);
+      uint32_t seq = header->space_seq.load();
+      bool full = head - header->tail.load() == header->info.capacity;
+      detail::robust_unlock(header->write_lock);
+      if (full)
+        detail::futex_wait(header->space_seq, seq);
+      header->writers_waiting.fetch_sub(1);
+    }
+  }
+
+  /// push an element if there is space, without blocking; returns false if
+  /// the channel is full, or another writer is part way through a push
+  bool try_push(const T &item) {
+    if (!detail::robust_try_lock(header->write_lock))
+      return false;
+    uint32_t head = header->head.load(std::memory_order_relaxed);
+    if (head - header->tail.load() == header->info.capacity) {
+      detail::robust_unlock(header->write_lock);
+      return false;
+    }
+    write_with_lock(head, item);
+    return true;
+  }
+
+  /// pop an element if there is one; returns false if the channel is empty
+  bool try_pop(T &item) {
+    uint32_t tail = header->tail.load(std::memory_order_relaxed);
+    if (header->head.load(std::memory_order_acquire) == tail)
+      return false;
+    item = slots[tail & (header->info.capacity - 1)];
+    header->tail.store(tail + 1);
+
+    if (header->writers_waiting.load() != 0) {
+      header->space_seq.fetch_add(1);
+      detail::futex_wake(header->space_seq);
+    }
+    return true;
+  }
+
+  /// pop an element, blocking if empty
+  T read() {
+    std::atomic<bool> stop(false);
+    T item;
+    while (!try_pop(item))
+      wait_readable(stop);
+    return item;
+  }
+
+  /// is this non-empty?
+  bool readable() const {
+    return header->head.load(std::memory_order_acquire) !=
+           header->tail.load(std::memory_order_relaxed);
+  }
+
+  /// block until this is readable, or stop is set and notify_reader() is
+  /// called; may return spuriously
+  void wait_readable(const std::atomic<bool> &stop) {
+    header->reader_waiting.store(1);
+    uint32_t seq = header->data_seq.load();
+    if (!readable() && !stop.load())
+      detail::futex_wait(header->data_seq, seq);
+    header->reader_waiting.store(0);
+  }
+
+  /// wake up the reader if it is blocked in wait_readable
+  void notify_reader() {
+    header->data_seq.fetch_add(1);
+    detail::futex_wake(header->data_seq);
+  }
+
+private:
+  explicit ShmChannel(std::shared_ptr<detail::ShmMapping> mapping)
+      : mapping(std::move(mapping)) {}
+
+  static constexpr size_t data_offset() {
+    return (sizeof(detail::ShmChannelHeader) + 63) / 64 * 64;
+  }
+
+  T *slots_for(detail::ShmChannelHeader *header) {
+    return reinterpret_cast<T *>(reinterpret_cast<char *>(header) +
+                                 data_offset());
+  }
+
+  void write_with_lock(uint32_t head, const T &item) {
+    slots[head & (header->info.capacity - 1)] = item;
+    header->head.store(head + 1);
+    detail::robust_unlock(header->write_lock);
+
+    if (header->reader_waiting.load() != 0)
+      notify_reader();
+  }
+
+  std::shared_ptr<detail::ShmMapping> mapping;
+  detail::ShmChannelHeader *header = nullptr;
+  T *slots = nullptr;
+};
+
+/// Actor which moves elements from a ShmChannel into a Channel, so that an
+/// actor can wait for elements from another process along with its other
+/// channels.
+template <typename T> class ShmRecvThread : Actor {
+public:
+  ShmRecvThread(ShmChannel<T> shm_channel, Channel<T> on_message)
+      : shm_channel(std::move(shm_channel)), on_message(std::move(on_message)),
+        stop(false) {}
+
+  void run() {
+    while (!stop.load()) {
+      T item;
+      while (shm_channel.try_pop(item))
+        on_message.push(item);
+      shm_channel.wait_readable(stop);
+    }
+  }
+
+  void exit() {
+    stop.store(true);
+    shm_channel.notify_reader();
+  }
+
+private:
+  ShmChannel<T> shm_channel;
+  Channel<T> on_message;
+  std::atomic<bool> stop;
+};
+
+} // namespace ACTORPP_CONFIG_NAMESPACE
+} // namespace actorpp
@@ -0,0 +1,725 @@
+#pragma once
+// instrumentation for channels, actors and their locks, enabled by defining
+// ACTORPP_CHANNEL_STATS, ACTORPP_CHANNEL_LATENCY, ACTORPP_ACTOR_STATS,
+// ACTORPP_LOCK_STATS or ACTORPP_WATCHDOG; this is included by actor.hpp when
+// it is needed
+#include "config.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cxxabi.h>
+#include <mutex>
+#include <ostream>
+#include <pthread.h>
+#include <set>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <time.h>
+#include <typeinfo>
+#include <vector>
+
+namespace actorpp {
+inline namespace ACTORPP_CONFIG_NAMESPACE {
+
+/// A log-linear histogram of non-negative values (usually durations in
+/// nanoseconds), in the style of HDR histograms: each power of two is split
+/// into 16 buckets, so values are recorded with at most 1/16 relative error.
+/// Values above max_value are recorded as max_value.
+class Histogram {
+public:
+  static constexpr int sub_bucket_bits = 4;
+  static constexpr uint64_t sub_buckets = 1 << sub_bucket_bits;
+  static constexpr int max_exponent = 39;
+  static constexpr uint64_t max_value = (uint64_t(1) << (max_exponent + 1)) - 1;
+  static constexpr size_t n_buckets =
+      sub_buckets + (max_exponent + 1 - sub_bucket_bits) * sub_buckets;
+
+  Histogram() : counts(n_buckets, 0), max_recorded(0) {}
+
+  /// from existing bucket counts, and the largest value recorded
+  Histogram(std::vector<uint64_t> counts, uint64_t max_recorded)
+      : counts(std::move(counts)), max_recorded(max_recorded) {}
+
+  static size_t bucket(uint64_t value) {
+    value = clamp(value);
+    if (value < sub_buckets)
+      return value;
+    int exponent = 63 - __builtin_clzll(value);
+    int shift = exponent - sub_bucket_bits;
+    return sub_buckets + shift * sub_buckets +
+           ((value >> shift) - sub_buckets);
+  }
+
+  /// the smallest value recorded in a bucket
+  static uint64_t bucket_lower(size_t index) {
+    if (index < sub_buckets)
+      return index;
+    size_t shift = (index - sub_buckets) / sub_buckets;
+    uint64_t sub = (index - sub_buckets) % sub_buckets;
+    return (sub_buckets + sub) << shift;
+  }
+
+  /// the largest value recorded in a bucket
+  static uint64_t bucket_upper(size_t index) {
+    if (index < sub_buckets)
+      return index;
+    size_t shift = (index - sub_buckets) / sub_buckets;
+    return bucket_lower(index) + (uint64_t(1) << shift) - 1;
+  }
+
+  void record(uint64_t value, uint64_t n = 1) {
+    counts[bucket(value)] += n;
+    max_recorded = std::max(max_recorded, clamp(value));
+  }
+
+  /// add the counts from another histogram
+  void merge(const Histogram &other) {
+    for (size_t i = 0; i < n_buckets; i++)
+      counts[i] += other.counts[i];
+    max_recorded = std::max(max_recorded, other.max_recorded);
+  }
+
+  uint64_t count() const {
+    uint64_t total = 0;
+    for (uint64_t n : counts)
+      total += n;
+    return total;
+  }
+
+  uint64_t max() const { return max_recorded; }
+
+  /// the value at percentile p (0-100), by nearest rank; this is the largest
+  /// value in the bucket containing that rank, so may be an overestimate by
+  /// up to the resolution of the histogram. Returns 0 if empty.
+  uint64_t percentile(double p) const {
+    uint64_t total = count();
+    if (total == 0)
+      return 0;
+    uint64_t rank = (uint64_t)(p / 100.0 * total + 0.999999);
+    rank = std::min(std::max(rank, (uint64_t)1), total);
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < n_buckets; i++) {
+      seen += counts[i];
+      if (seen >= rank)
+        return std::min(bucket_upper(i), max_recorded);
+    }
+    return max_recorded;
+  }
+
+  /// the count in each bucket, see bucket_lower and bucket_upper
+  std::vector<uint64_t> counts;
+
+private:
+  static uint64_t clamp(uint64_t value) {
+    return value > max_value ? max_value : value;
+  }
+
+  uint64_t max_recorded;
+};
+
+/// a snapshot of the counters for one channel
+struct ChannelStats {
+  /// unique for each channel, increasing in order of creation
+  uint64_t id;
+  std::string name;
+  /// the number of elements currently in the channel
+  uint64_t depth;
+  /// the largest depth seen
+  uint64_t high_water;
+  uint64_t pushed;
+  uint64_t popped;
+  /// bytes pushed and popped, for element types with a size() method
+  /// (containers, strings and buffers); otherwise zero
+  uint64_t bytes_pushed;
+  uint64_t bytes_popped;
+  /// the time in nanoseconds between each element being pushed and popped; this
+  /// is only recorded if ACTORPP_CHANNEL_LATENCY is defined
+  Histogram sojourn_ns;
+  /// how long the oldest element has been in the channel, or 0 if it is empty;
+  /// this is only recorded if ACTORPP_CHANNEL_LATENCY or ACTORPP_WATCHDOG is
+  /// defined
+  uint64_t head_age_ns;
+  /// the ActorStats::id of the actor this channel is associated with; this is
+  /// only recorded if ACTORPP_ACTOR_STATS is defined
+  bool has_actor;
+  uint64_t actor_id;
+};
+
+namespace detail {
+/// the size in bytes of a message, if it has a size; the second argument picks
+/// the first overload which is valid
+template <typename T>
+auto message_bytes_impl(const T &value, int)
+    -> decltype(value.size() * sizeof(typename T::value_type)) {
+  return value.size() * sizeof(typename T::value_type);
+}
+
+template <typename T>
+auto message_bytes_impl(const T &value, long)
+    -> decltype(size_t(value.size())) {
+  return value.size();
+}
+
+template <typename T> size_t message_bytes_impl(const T &, ...) { return 0; }
+
+template <typename T> size_t message_bytes(const T &value) {
+  return message_bytes_impl(value, 0);
+}
+
+inline uint64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+/// add to a counter which is only written with a lock held, so doesn't need
+/// an atomic read-modify-write, but may be read at any time
+inline void add_relaxed(std::atomic<uint64_t> &counter, uint64_t n) {
+  counter.store(counter.load(std::memory_order_relaxed) + n,
+                std::memory_order_relaxed);
+}
+
+struct ActorStatsEntry;
+
+/// the counters for one channel. These are updated with the channel's lock
+/// held, and read without it; the name is protected by the registry's lock
+struct ChannelStatsEntry {
+  /// actor is the entry for the actor this channel is associated with, if
+  /// ACTORPP_ACTOR_STATS is defined
+  explicit ChannelStatsEntry(const ActorStatsEntry *actor = nullptr);
+  ~ChannelStatsEntry();
+
+  ChannelStatsEntry(const ChannelStatsEntry &) = delete;
+  ChannelStatsEntry &operator=(const ChannelStatsEntry &) = delete;
+
+  uint64_t id;
+  std::string name;
+  std::atomic<uint64_t> pushed{0};
+  std::atomic<uint64_t> popped{0};
+  std::atomic<uint64_t> high_water{0};
+  std::atomic<uint64_t> bytes_pushed{0};
+  std::atomic<uint64_t> bytes_popped{0};
+  /// the time the oldest element was pushed, or 0 if empty
+  std::atomic<uint64_t> head_push_ns{0};
+  bool has_actor = false;
+  uint64_t actor_id = 0;
+
+  void on_push(uint64_t depth, size_t bytes) {
+    add_relaxed(pushed, 1);
+    add_relaxed(bytes_pushed, bytes);
+    if (depth > high_water.load(std::memory_order_relaxed))
+      high_water.store(depth, std::memory_order_relaxed);
+  }
+
+  void on_pop(size_t bytes) {
+    add_relaxed(popped, 1);
+    add_relaxed(bytes_popped, bytes);
+  }
+
+#ifdef ACTORPP_CHANNEL_LATENCY
+  /// Histogram::n_buckets counts, allocated by the first on_sojourn so that
+  /// channels which are never popped from stay small; null until then
+  std::atomic<std::atomic<uint64_t> *> sojourn_counts{nullptr};
+  std::atomic<uint64_t> sojourn_max{0};
+
+  void on_sojourn(uint64_t ns) {
+    std::atomic<uint64_t> *counts =
+        sojourn_counts.load(std::memory_order_relaxed);
+    if (!counts) {
+      counts = new std::atomic<uint64_t>[Histogram::n_buckets]();
+      sojourn_counts.store(counts, std::memory_order_release);
+    }
+    add_relaxed(counts[Histogram::bucket(ns)], 1);
+    if (ns > sojourn_max.load(std::memory_order_relaxed))
+      sojourn_max.store(ns, std::memory_order_relaxed);
+  }
+#endif
+
+  void set_head(uint64_t push_ns) {
+    head_push_ns.store(push_ns, std::memory_order_relaxed);
+  }
+
+  ChannelStats snapshot() const {
+    ChannelStats stats;
+    stats.id = id;
+    stats.name = name;
+    stats.has_actor = has_actor;
+    stats.actor_id = actor_id;
+    uint64_t head = head_push_ns.load(std::memory_order_relaxed);
+    uint64_t now = now_ns();
+    stats.head_age_ns = head && now > head ? now - head : 0;
+    stats.popped = popped.load(std::memory_order_relaxed);
+    stats.pushed = pushed.load(std::memory_order_relaxed);
+    stats.depth =
+        stats.pushed > stats.popped ? stats.pushed - stats.popped : 0;
+    stats.high_water = high_water.load(std::memory_order_relaxed);
+    stats.bytes_pushed = bytes_pushed.load(std::memory_order_relaxed);
+    stats.bytes_popped = bytes_popped.load(std::memory_order_relaxed);
+#ifdef ACTORPP_CHANNEL_LATENCY
+    std::vector<uint64_t> counts(Histogram::n_buckets);
+    const std::atomic<uint64_t> *sojourn =
+        sojourn_counts.load(std::memory_order_acquire);
+    if (sojourn)
+      for (size_t i = 0; i < Histogram::n_buckets; i++)
+        counts[i] = sojourn[i].load(std::memory_order_relaxed);
+    stats.sojourn_ns = Histogram(std::move(counts),
+                                 sojourn_max.load(std::memory_order_relaxed));
+#endif
+    return stats;
+  }
+};
+
+/// all live entries of one type (channels or actors)
+template <typename Entry> struct Registry {
+  std::mutex mut;
+  uint64_t next_id = 0;
+  std::set<Entry *> entries;
+
+  /// never destroyed, so that entries in static objects can unregister
+  static Registry &get() {
+    static Registry *registry = new Registry;
+    return *registry;
+  }
+
+  void add(Entry *entry) {
+    std::unique_lock<std::mutex> lock(mut);
+    entry->id = next_id++;
+    entries.insert(entry);
+  }
+
+  void remove(Entry *entry) {
+    std::unique_lock<std::mutex> lock(mut);
+    entries.erase(entry);
+  }
+
+  /// snapshots of all entries, in order of creation
+  template <typename Stats> std::vector<Stats> snapshot_all() {
+    std::vector<Stats> stats;
+    {
+      std::unique_lock<std::mutex> lock(mut);
+      for (const Entry *entry : entries)
+        stats.push_back(entry->snapshot());
+    }
+    std::sort(stats.begin(), stats.end(),
+              [](const Stats &a, const Stats &b) { return a.id < b.id; });
+    return stats;
+  }
+};
+
+typedef Registry<ChannelStatsEntry> ChannelRegistry;
+
+inline ChannelStatsEntry::~ChannelStatsEntry() {
+  ChannelRegistry::get().remove(this);
+#ifdef ACTORPP_CHANNEL_LATENCY
+  delete[] sojourn_counts.load(std::memory_order_relaxed);
+#endif
+}
+
+inline void set_channel_name(ChannelStatsEntry &entry, std::string name) {
+  ChannelRegistry &registry = ChannelRegistry::get();
+  std::unique_lock<std::mutex> lock(registry.mut);
+  entry.name = std::move(name);
+}
+
+inline ChannelStats channel_stats(const ChannelStatsEntry &entry) {
+  ChannelRegistry &registry = ChannelRegistry::get();
+  std::unique_lock<std::mutex> lock(registry.mut);
+  return entry.snapshot();
+}
+} // namespace detail
+
+/// get the counters for all live channels, in order of creation. The counters
+/// are read without taking the channels' locks, so this doesn't slow them down,
+/// but the counters for each channel may not be exactly consistent.
+inline std::vector<ChannelStats> channel_stats() {
+  return detail::ChannelRegistry::get().snapshot_all<ChannelStats>();
+}
+
+/// a snapshot of the time accounting for one actor
+struct ActorStats {
+  /// unique for each actor, increasing in order of creation
+  uint64_t id;
+  /// set by Actor::set_name, or the type name for actors run by ActorThread
+  std::string name;
+  /// time since the actor was created
+  uint64_t wall_ns;
+  /// time spent in wait, wait_for, wait_until, and Channel::read on channels
+  /// associated with this actor
+  uint64_t blocked_ns;
+  /// wall_ns - blocked_ns
+  uint64_t running_ns;
+  /// the number of calls which could block
+  uint64_t waits;
+  /// CPU time used by the thread running this actor, if it is run by
+  /// ActorThread; otherwise 0
+  uint64_t cpu_ns;
+  /// the time since the actor last returned from a wait, or 0 if it is waiting,
+  /// has never waited, or its ActorThread has finished
+  uint64_t since_wait_ns;
+
+  /// the fraction of the time that the actor was not blocked
+  double utilisation() const {
+    return wall_ns ? (double)running_ns / wall_ns : 0.0;
+  }
+};
+
+namespace detail {
+inline uint64_t thread_cpu_ns(clockid_t clock) {
+  timespec ts;
+  if (clock_gettime(clock, &ts) != 0)
+    return 0;
+  return uint64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+/// thread names are limited to 15 characters on linux
+inline void set_thread_name(pthread_t thread, const std::string &name) {
+  pthread_setname_np(thread, name.substr(0, 15).c_str());
+}
+
+/// the name of a type without namespaces or template arguments
+inline std::string short_type_name(const std::type_info &type) {
+  int status;
+  char *demangled = abi::__cxa_demangle(type.name(), nullptr, nullptr, &status);
+  std::string name = status == 0 ? demangled : type.name();
+  free(demangled);
+
+  name = name.substr(0, name.find('<'));
+  size_t colons = name.rfind("::");
+  return colons == std::string::npos ? name : name.substr(colons + 2);
+}
+
+/// the time accounting for one actor. Only Actors are registered, not the
+/// anonymous ActorImpls behind channels without an actor. The counters may be
+/// updated from any thread which reads from the actor's channels; the name and
+/// thread fields are protected by the registry's lock.
+struct ActorStatsEntry {
+  ActorStatsEntry() : created_ns(now_ns()) {}
+  ~ActorStatsEntry();
+
+  ActorStatsEntry(const ActorStatsEntry &) = delete;
+  ActorStatsEntry &operator=(const ActorStatsEntry &) = delete;
+
+  uint64_t id = 0;
+  bool registered = false;
+  std::string name;
+  uint64_t created_ns;
+  std::atomic<uint64_t> blocked_ns{0};
+  std::atomic<uint64_t> waits{0};
+  /// the time of the last return from a wait, or 0 while waiting
+  std::atomic<uint64_t> woke_ns{0};
+
+  /// is an ActorThread running this actor?
+  bool on_thread = false;
+  pthread_t thread;
+  clockid_t cpu_clock;
+  /// the CPU time of the thread once it has finished
+  uint64_t final_cpu_ns = 0;
+
+  void on_wait_start() { woke_ns.store(0, std::memory_order_relaxed); }
+
+  void on_wait(uint64_t start_ns, uint64_t end_ns) {
+    blocked_ns.fetch_add(end_ns - start_ns, std::memory_order_relaxed);
+    waits.fetch_add(1, std::memory_order_relaxed);
+    woke_ns.store(end_ns, std::memory_order_relaxed);
+  }
+
+  ActorStats snapshot() const {
+    ActorStats stats;
+    stats.id = id;
+    stats.name = name;
+    stats.wall_ns = now_ns() - created_ns;
+    stats.blocked_ns =
+        std::min(blocked_ns.load(std::memory_order_relaxed), stats.wall_ns);
+    stats.running_ns = stats.wall_ns - stats.blocked_ns;
+    stats.waits = waits.load(std::memory_order_relaxed);
+    stats.cpu_ns = on_thread ? thread_cpu_ns(cpu_clock) : final_cpu_ns;
+    uint64_t woke = woke_ns.load(std::memory_order_relaxed);
+    uint64_t now = now_ns();
+    stats.since_wait_ns = woke && now > woke ? now - woke : 0;
+    return stats;
+  }
+};
+
+typedef Registry<ActorStatsEntry> ActorRegistry;
+
+inline ChannelStatsEntry::ChannelStatsEntry(const ActorStatsEntry *actor) {
+  if (actor && actor->registered) {
+    has_actor = true;
+    actor_id = actor->id;
+  }
+  ChannelRegistry::get().add(this);
+}
+
+inline ActorStatsEntry::~ActorStatsEntry() {
+  if (registered)
+    ActorRegistry::get().remove(this);
+}
+
+inline void register_actor(ActorStatsEntry &entry) {
+  entry.registered = true;
+  ActorRegistry::get().add(&entry);
+}
+
+inline void set_actor_name(ActorStatsEntry &entry, std::string name) {
+  ActorRegistry &registry = ActorRegistry::get();
+  std::unique_lock<std::mutex> lock(registry.mut);
+  entry.name = std::move(name);
+  if (entry.on_thread)
+    set_thread_name(entry.thread, entry.name);
+}
+
+inline ActorStats actor_stats(const ActorStatsEntry &entry) {
+  ActorRegistry &registry = ActorRegistry::get();
+  std::unique_lock<std::mutex> lock(registry.mut);
+  return entry.snapshot();
+}
+
+/// the number of live ActorThreadScopes
+inline std::atomic<uint64_t> &running_actor_threads() {
+  static std::atomic<uint64_t> count{0};
+  return count;
+}
+
+/// names the current thread after an actor, and associates the thread with
+/// the actor's entry (if it has one) so that its CPU time can be read, for the
+/// lifetime of this object
+class ActorThreadScope {
+public:
+  ActorThreadScope(ActorStatsEntry *entry, const std::type_info &type)
+      : entry(entry) {
+    running_actor_threads().fetch_add(1, std::memory_order_relaxed);
+    if (!entry) {
+      set_thread_name(pthread_self(), short_type_name(type));
+      return;
+    }
+
+    ActorRegistry &registry = ActorRegistry::get();
+    std::unique_lock<std::mutex> lock(registry.mut);
+    if (entry->name.empty())
+      entry->name = short_type_name(type);
+    entry->thread = pthread_self();
+    set_thread_name(entry->thread, entry->name);
+    entry->on_thread =
+        pthread_getcpuclockid(entry->thread, &entry->cpu_clock) == 0;
+  }
+
+  ~ActorThreadScope() {
+    running_actor_threads().fetch_sub(1, std::memory_order_relaxed);
+    if (!entry)
+      return;
+    ActorRegistry &registry = ActorRegistry::get();
+    std::unique_lock<std::mutex> lock(registry.mut);
+    if (entry->on_thread)
+      entry->final_cpu_ns = thread_cpu_ns(entry->cpu_clock);
+    entry->on_thread = false;
+    entry->woke_ns.store(0, std::memory_order_relaxed);
+  }
+
+  ActorThreadScope(const ActorThreadScope &) = delete;
+  ActorThreadScope &operator=(const ActorThreadScope &) = delete;
+
+private:
+  ActorStatsEntry *entry;
+};
+
+/// the stats entry of an actor, if it publicly derives from Actor
+template <typename A>
+auto actor_stats_entry(A &actor, int) -> decltype(&actor.impl->stats) {
+  return &actor.impl->stats;
+}
+
+template <typename A> ActorStatsEntry *actor_stats_entry(A &, ...) {
+  return nullptr;
+}
+} // namespace detail
+
+/// get the time accounting for all live actors, in order of creation
+inline std::vector<ActorStats> actor_stats() {
+  return detail::ActorRegistry::get().snapshot_all<ActorStats>();
+}
+
+/// the number of ActorThreads whose run method is running; this is only
+/// counted if ACTORPP_ACTOR_STATS or ACTORPP_TRACE is defined
+inline uint64_t actor_thread_count() {
+  return detail::running_actor_threads().load(std::memory_order_relaxed);
+}
+
+/// a snapshot of the contention counters for one actor's lock
+struct LockStats {
+  /// unique for each lock, increasing in order of creation
+  uint64_t id;
+  /// set by Actor::set_name, or the type name for actors run by ActorThread
+  std::string name;
+  uint64_t acquisitions;
+  /// acquisitions which had to wait for another thread to release the lock
+  uint64_t contended;
+  /// total and longest time spent waiting to acquire the lock
+  uint64_t wait_ns;
+  uint64_t max_wait_ns;
+  /// total and longest time the lock was held
+  uint64_t hold_ns;
+  uint64_t max_hold_ns;
+};
+
+namespace detail {
+/// the counters for one lock. These are updated with the lock held, and read
+/// without it; the name is protected by the registry's lock
+struct LockStatsEntry {
+  LockStatsEntry();
+  ~LockStatsEntry();
+
+  LockStatsEntry(const LockStatsEntry &) = delete;
+  LockStatsEntry &operator=(const LockStatsEntry &) = delete;
+
+  uint64_t id;
+  std::string name;
+  std::atomic<uint64_t> acquisitions{0};
+  std::atomic<uint64_t> contended{0};
+  std::atomic<uint64_t> wait_ns{0};
+  std::atomic<uint64_t> max_wait_ns{0};
+  std::atomic<uint64_t> hold_ns{0};
+  std::atomic<uint64_t> max_hold_ns{0};
+
+  static void set_max(std::atomic<uint64_t> &max, uint64_t value) {
+    if (value > max.load(std::memory_order_relaxed))
+      max.store(value, std::memory_order_relaxed);
+  }
+
+  void on_acquire(uint64_t waited_ns, bool was_contended) {
+    add_relaxed(acquisitions, 1);
+    if (was_contended) {
+      add_relaxed(contended, 1);
+      add_relaxed(wait_ns, waited_ns);
+      set_max(max_wait_ns, waited_ns);
+    }
+  }
+
+  void on_release(uint64_t held_ns) {
+    add_relaxed(hold_ns, held_ns);
+    set_max(max_hold_ns, held_ns);
+  }
+
+  LockStats snapshot() const {
+    LockStats stats;
+    stats.id = id;
+    stats.name = name;
+    stats.acquisitions = acquisitions.load(std::memory_order_relaxed);
+    stats.contended = contended.load(std::memory_order_relaxed);
+    stats.wait_ns = wait_ns.load(std::memory_order_relaxed);
+    stats.max_wait_ns = max_wait_ns.load(std::memory_order_relaxed);
+    stats.hold_ns = hold_ns.load(std::memory_order_relaxed);
+    stats.max_hold_ns = max_hold_ns.load(std::memory_order_relaxed);
+    return stats;
+  }
+};
+
+typedef Registry<LockStatsEntry> LockRegistry;
+
+inline LockStatsEntry::LockStatsEntry() { LockRegistry::get().add(this); }
+
+inline LockStatsEntry::~LockStatsEntry() { LockRegistry::get().remove(this); }
+
+inline void set_lock_name(LockStatsEntry &entry, std::string name,
+                          bool only_if_unnamed = false) {
+  LockRegistry &registry = LockRegistry::get();
+  std::unique_lock<std::mutex> lock(registry.mut);
+  if (!only_if_unnamed || entry.name.empty())
+    entry.name = std::move(name);
+}
+
+inline LockStats lock_stats(const LockStatsEntry &entry) {
+  LockRegistry &registry = LockRegistry::get();
+  std::unique_lock<std::mutex> lock(registry.mut);
+  return entry.snapshot();
+}
+
+/// the lock stats entry of an actor, if it publicly derives from Actor and
+/// ACTORPP_LOCK_STATS is defined
+template <typename A>
+auto actor_lock_stats(A &actor, int) -> decltype(&actor.impl->mut.stats) {
+  return &actor.impl->mut.stats;
+}
+
+template <typename A> LockStatsEntry *actor_lock_stats(A &, ...) {
+  return nullptr;
+}
+} // namespace detail
+
+/// A mutex which records how often and for how long it is waited for and
+/// held. This is used for the lock shared by all channels of an actor if
+/// ACTORPP_LOCK_STATS is defined.
+class ProfiledMutex {
+public:
+  void lock() {
+    bool contended = !mut.try_lock();
+    uint64_t start = detail::now_ns();
+    if (contended)
+      mut.lock();
+    locked_ns = contended ? detail::now_ns() : start;
+    stats.on_acquire(locked_ns - start, contended);
+  }
+
+  bool try_lock() {
+    if (!mut.try_lock())
+      return false;
+    locked_ns = detail::now_ns();
+    stats.on_acquire(0, false);
+    return true;
+  }
+
+  void unlock() {
+    stats.on_release(detail::now_ns() - locked_ns);
+    mut.unlock();
+  }
+
+  detail::LockStatsEntry stats;
+
+private:
+  std::mutex mut;
+  /// when the lock was last acquired; only accessed with it held
+  uint64_t locked_ns = 0;
+};
+
+/// get the contention counters for all live locks, in order of creation
+inline std::vector<LockStats> lock_stats() {
+  return detail::LockRegistry::get().snapshot_all<LockStats>();
+}
+
+/// get the contention counters for the n live locks with the most total time
+/// spent waiting to acquire them, most contended first
+inline std::vector<LockStats> most_contended_locks(size_t n = 10) {
+  std::vector<LockStats> stats = lock_stats();
+  std::stable_sort(stats.begin(), stats.end(),
+                   [](const LockStats &a, const LockStats &b) {
+                     return a.wait_ns > b.wait_ns;
+                   });
+  if (stats.size() > n)
+    stats.resize(n);
+  return stats;
+}
+
+/// write a table of the n most contended locks to out
+inline void write_lock_report(std::ostream &out, size_t n = 10) {
+  char line[160];
+  snprintf(line, sizeof(line), "%-20s %9s %10s %9s %12s %9s %12s\n", "lock",
+           "acquired", "contended", "wait ms", "max wait us", "hold ms",
+           "max hold us");
+  out << line;
+
+  for (const LockStats &s : most_contended_locks(n)) {
+    std::string name =
+        s.name.empty() ? "#" + std::to_string(s.id) : s.name.substr(0, 20);
+    snprintf(line, sizeof(line),
+             "%-20s %9llu %10llu %9.3f %12.1f %9.3f %12.1f\n", name.c_str(),
+             (unsigned long long)s.acquisitions,
+             (unsigned long long)s.contended, s.wait_ns * 1e-6,
+             s.max_wait_ns * 1e-3, s.hold_ns * 1e-6, s.max_hold_ns * 1e-3);
+    out << line;
+  }
+}
+
+} // namespace ACTORPP_CONFIG_NAMESPACE
+} // namespace actorpp
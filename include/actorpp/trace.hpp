@@ -0,0 +1,311 @@
+#pragma once
+// tracing of messages between actors, enabled by defining ACTORPP_TRACE; this
+// is included by actor.hpp when it is needed. TraceSpan can be used whether or
+// not tracing is enabled.
+#include "config.hpp"
+#ifdef ACTORPP_TRACE
+#include "stats.hpp"
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+#ifndef ACTORPP_TRACE_BUFFER_SIZE
+/// the number of events kept for each thread; older events are overwritten
+#define ACTORPP_TRACE_BUFFER_SIZE 16384
+#endif
+
+#ifndef ACTORPP_TRACE_RETIRED_THREADS
+/// the number of threads which have exited to keep events for
+#define ACTORPP_TRACE_RETIRED_THREADS 64
+#endif
+#endif
+
+namespace actorpp {
+inline namespace ACTORPP_CONFIG_NAMESPACE {
+
+#ifdef ACTORPP_TRACE
+namespace detail {
+enum class TraceKind : uint8_t { Span, Push, Pop };
+
+/// a copy of one recorded event
+struct TraceEvent {
+  TraceKind kind;
+  const char *name;
+  uint64_t start_ns;
+  uint64_t end_ns;
+  /// the channel pushed to or popped from
+  const void *channel;
+  /// links a push to the corresponding pop
+  uint64_t flow;
+};
+
+/// storage for one event in a TraceBuffer. Every field is atomic so that
+/// events can be read while they are being overwritten: seq is cleared before
+/// the other fields are written and set to the event index plus one after, so
+/// that readers can detect and skip torn events
+struct TraceSlot {
+  std::atomic<uint64_t> seq;
+  std::atomic<uint8_t> kind;
+  std::atomic<const char *> name;
+  std::atomic<uint64_t> start_ns;
+  std::atomic<uint64_t> end_ns;
+  std::atomic<const void *> channel;
+  std::atomic<uint64_t> flow;
+};
+
+/// a ring buffer of events written by one thread, and read by any thread
+/// without locking
+class TraceBuffer {
+public:
+  static constexpr size_t size = ACTORPP_TRACE_BUFFER_SIZE;
+
+  TraceBuffer() : tid(syscall(SYS_gettid)), slots(new TraceSlot[size]()) {
+    char name[16] = {};
+    pthread_getname_np(pthread_self(), name, sizeof(name));
+    thread_name = name;
+  }
+
+  /// only call this from the owning thread
+  void record(const TraceEvent &event) {
+    uint64_t index = next.load(std::memory_order_relaxed);
+    TraceSlot &slot = slots[index % size];
+
+    slot.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.kind.store((uint8_t)event.kind, std::memory_order_relaxed);
+    slot.name.store(event.name, std::memory_order_relaxed);
+    slot.start_ns.store(event.start_ns, std::memory_order_relaxed);
+    slot.end_ns.store(event.end_ns, std::memory_order_relaxed);
+    slot.channel.store(event.channel, std::memory_order_relaxed);
+    slot.flow.store(event.flow, std::memory_order_relaxed);
+    slot.seq.store(index + 1, std::memory_order_release);
+
+    next.store(index + 1, std::memory_order_release);
+  }
+
+  /// a new flow ID, unique across threads; only call this from the owning
+  /// thread
+  uint64_t next_flow() { return (uint64_t(tid) << 32) | ++flow_counter; }
+
+  /// copies of the events currently in the buffer, oldest first
+  std::vector<TraceEvent> events() const {
+    std::vector<TraceEvent> events;
+    uint64_t end = next.load(std::memory_order_acquire);
+    uint64_t start = end > size ? end - size : 0;
+    for (uint64_t index = start; index < end; index++) {
+      const TraceSlot &slot = slots[index % size];
+      if (slot.seq.load(std::memory_order_acquire) != index + 1)
+        continue;
+
+      TraceEvent event;
+      event.kind = (TraceKind)slot.kind.load(std::memory_order_relaxed);
+      event.name = slot.name.load(std::memory_order_relaxed);
+      event.start_ns = slot.start_ns.load(std::memory_order_relaxed);
+      event.end_ns = slot.end_ns.load(std::memory_order_relaxed);
+      event.channel = slot.channel.load(std::memory_order_relaxed);
+      event.flow = slot.flow.load(std::memory_order_relaxed);
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.seq.load(std::memory_order_relaxed) == index + 1)
+        events.push_back(event);
+    }
+    return events;
+  }
+
+  const int tid;
+  std::string thread_name;
+
+private:
+  std::unique_ptr<TraceSlot[]> slots;
+  std::atomic<uint64_t> next{0};
+  uint32_t flow_counter = 0;
+};
+
+/// the buffers of all live threads which have recorded events, and of the
+/// most recent threads to exit
+struct TraceRegistry {
+  std::mutex mut;
+  std::vector<std::shared_ptr<TraceBuffer>> live;
+  std::deque<std::shared_ptr<TraceBuffer>> retired;
+  /// events which started before this are not written
+  std::atomic<uint64_t> cleared_ns{0};
+
+  /// never destroyed, so that threads can exit after main returns
+  static TraceRegistry &get() {
+    static TraceRegistry *registry = new TraceRegistry;
+    return *registry;
+  }
+
+  std::vector<std::shared_ptr<TraceBuffer>> buffers() {
+    std::unique_lock<std::mutex> lock(mut);
+    std::vector<std::shared_ptr<TraceBuffer>> all(live);
+    all.insert(all.end(), retired.begin(), retired.end());
+    return all;
+  }
+};
+
+/// owns the buffer for one thread, retiring it when the thread exits
+struct ThreadTrace {
+  std::shared_ptr<TraceBuffer> buffer;
+
+  ThreadTrace() : buffer(std::make_shared<TraceBuffer>()) {
+    TraceRegistry &registry = TraceRegistry::get();
+    std::unique_lock<std::mutex> lock(registry.mut);
+    registry.live.push_back(buffer);
+  }
+
+  ~ThreadTrace() {
+    TraceRegistry &registry = TraceRegistry::get();
+    std::unique_lock<std::mutex> lock(registry.mut);
+    registry.live.erase(
+        std::find(registry.live.begin(), registry.live.end(), buffer));
+    registry.retired.push_back(buffer);
+    if (registry.retired.size() > ACTORPP_TRACE_RETIRED_THREADS)
+      registry.retired.pop_front();
+  }
+};
+
+inline TraceBuffer &thread_trace() {
+  static thread_local ThreadTrace trace;
+  return *trace.buffer;
+}
+
+inline void trace_span(const char *name, uint64_t start_ns, uint64_t end_ns) {
+  thread_trace().record(
+      {TraceKind::Span, name, start_ns, end_ns, nullptr, 0});
+}
+
+/// record a push to channel, returning the flow ID to pass to trace_pop
+inline uint64_t trace_push(const void *channel) {
+  TraceBuffer &buffer = thread_trace();
+  uint64_t flow = buffer.next_flow();
+  uint64_t now = now_ns();
+  buffer.record({TraceKind::Push, "push", now, now, channel, flow});
+  return flow;
+}
+
+inline void trace_pop(const void *channel, uint64_t flow) {
+  uint64_t now = now_ns();
+  thread_trace().record({TraceKind::Pop, "pop", now, now, channel, flow});
+}
+
+inline void write_json_string(std::ostream &out, const char *s) {
+  out << '"';
+  for (; *s; s++) {
+    if (*s == '"' || *s == '\\')
+      out << '\\' << *s;
+    else if ((unsigned char)*s < 0x20) {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", *s);
+      out << escaped;
+    } else
+      out << *s;
+  }
+  out << '"';
+}
+
+/// write a time in nanoseconds as microseconds, the unit used by the format
+inline void write_us(std::ostream &out, uint64_t ns) {
+  char us[32];
+  snprintf(us, sizeof(us), "%llu.%03u", (unsigned long long)(ns / 1000),
+           (unsigned)(ns % 1000));
+  out << us;
+}
+
+inline void write_trace_event(std::ostream &out, int pid, int tid,
+                              const TraceEvent &event) {
+  out << "{\"ph\": \"X\", \"cat\": \"actorpp\", \"pid\": " << pid
+      << ", \"tid\": " << tid << ", \"name\": ";
+  write_json_string(out, event.name);
+  out << ", \"ts\": ";
+  write_us(out, event.start_ns);
+  out << ", \"dur\": ";
+  write_us(out, event.end_ns - event.start_ns);
+  if (event.kind != TraceKind::Span) {
+    out << ", \"bind_id\": \"0x" << std::hex << event.flow << "\", "
+        << (event.kind == TraceKind::Push ? "\"flow_out\"" : "\"flow_in\"")
+        << ": true, \"args\": {\"channel\": \"" << event.channel << "\"}"
+        << std::dec;
+  }
+  out << "}";
+}
+} // namespace detail
+
+/// Write the recorded events of all threads to out in Chrome trace JSON
+/// format, which can be loaded in Perfetto (https://ui.perfetto.dev) or
+/// chrome://tracing. Each push to and pop from a channel is shown as an
+/// instant on the thread that did it, with a flow arrow from each push to the
+/// corresponding pop; time spent in wait and read, and TraceSpans, are shown
+/// as slices.
+///
+/// This can be called while other threads are recording events; only the
+/// most recent ACTORPP_TRACE_BUFFER_SIZE events on each thread are kept.
+inline void write_trace(std::ostream &out) {
+  detail::TraceRegistry &registry = detail::TraceRegistry::get();
+  uint64_t cleared_ns = registry.cleared_ns.load(std::memory_order_relaxed);
+  int pid = getpid();
+
+  out << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+  const char *separator = "\n";
+  for (auto &buffer : registry.buffers()) {
+    out << separator << "{\"ph\": \"M\", \"pid\": " << pid
+        << ", \"tid\": " << buffer->tid
+        << ", \"name\": \"thread_name\", \"args\": {\"name\": ";
+    detail::write_json_string(out, buffer->thread_name.c_str());
+    out << "}}";
+    separator = ",\n";
+
+    for (const detail::TraceEvent &event : buffer->events())
+      if (event.start_ns >= cleared_ns) {
+        out << separator;
+        detail::write_trace_event(out, pid, buffer->tid, event);
+      }
+  }
+  out << "\n]}\n";
+}
+
+/// discard the events recorded so far
+inline void clear_trace() {
+  detail::TraceRegistry &registry = detail::TraceRegistry::get();
+  registry.cleared_ns.store(detail::now_ns(), std::memory_order_relaxed);
+  std::unique_lock<std::mutex> lock(registry.mut);
+  registry.retired.clear();
+}
+#endif
+
+/// Records a slice on the current thread from construction to destruction, for
+/// example around the handling of a message. name must live until the trace
+/// is written, so is usually a string literal. This does nothing unless
+/// ACTORPP_TRACE is defined.
+class TraceSpan {
+public:
+#ifdef ACTORPP_TRACE
+  explicit TraceSpan(const char *name)
+      : name(name), start_ns(detail::now_ns()) {}
+  ~TraceSpan() { detail::trace_span(name, start_ns, detail::now_ns()); }
+#else
+  explicit TraceSpan(const char *) {}
+#endif
+
+  TraceSpan(const TraceSpan &) = delete;
+  TraceSpan &operator=(const TraceSpan &) = delete;
+
+#ifdef ACTORPP_TRACE
+private:
+  const char *name;
+  uint64_t start_ns;
+#endif
+};
+
+} // namespace ACTORPP_CONFIG_NAMESPACE
+} // namespace actorpp
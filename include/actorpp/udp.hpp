@@ -0,0 +1,239 @@
+#pragma once
+#include "actor.hpp"
+#include "buffer.hpp"
+#include "net.hpp"
+#include <algorithm>
+#include <errno.h>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string.h>
+#include <sys/socket.h>
+#include <vector>
+
+namespace actorpp {
+inline namespace ACTORPP_CONFIG_NAMESPACE {
+
+/// a datagram received from address, or to be sent to address. To send to
+/// the peer of a connected socket, use a value-initialised Address{}
+struct Datagram {
+  Address address;
+  Buffer data;
+};
+
+/// create a UDP socket bound to hostname:port; port may be 0 to pick a free
+/// port, see local_port
+inline int bind_udp(const std::string &hostname, int port,
+                    const SocketOptions &options = SocketOptions()) {
+  return detail::bind_socket(resolve(hostname, port, SOCK_DGRAM)[0], options);
+}
+
+/// create a UDP socket connected to hostname:port, so that only datagrams from
+/// there are received, and datagrams without an address are sent there
+inline int connect_udp(const std::string &hostname, int port,
+                       const SocketOptions &options = SocketOptions()) {
+  return connect(resolve(hostname, port, SOCK_DGRAM), options);
+}
+
+/// send datagrams, using as few sendmmsg calls as possible
+inline void send_datagrams(int fd, const std::vector<Datagram> &datagrams) {
+  const size_t max_batch = 1024;
+  std::vector<struct mmsghdr> msgs(std::min(datagrams.size(), max_batch));
+  std::vector<struct iovec> iovs(msgs.size());
+
+  size_t sent = 0;
+  while (sent < datagrams.size()) {
+    size_t n = std::min(datagrams.size() - sent, max_batch);
+    for (size_t i = 0; i < n; i++) {
+      const Datagram &datagram = datagrams[sent + i];
+      iovs[i].iov_base = (void *)datagram.data.data();
+      iovs[i].iov_len = datagram.data.size();
+
+      memset(&msgs[i], 0, sizeof(msgs[i]));
+      msgs[i].msg_hdr.msg_iov = &iovs[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+      if (datagram.address.addrlen != 0) {
+        msgs[i].msg_hdr.msg_name = (void *)&datagram.address.addr;
+        msgs[i].msg_hdr.msg_namelen = datagram.address.addrlen;
+      }
+    }
+
+    int ret = sendmmsg(fd, msgs.data(), n, MSG_NOSIGNAL);
+    if (ret <= 0)
+      throw std::runtime_error("sendmmsg() failed");
+    sent += ret;
+  }
+}
+
+namespace detail {
+/// Blocks of memory of one size, which are kept for reuse when the last
+/// reference to them is dropped, so that they are only allocated (and zeroed)
+/// when more are in use than ever before. At most max_free blocks are kept.
+class BlockPool : public std::enable_shared_from_this<BlockPool> {
+public:
+  BlockPool(size_t block_size, size_t max_free)
+      : block_size(block_size), max_free(max_free) {}
+
+  std::shared_ptr<std::vector<uint8_t>> get() {
+    std::unique_ptr<std::vector<uint8_t>> block;
+    {
+      std::unique_lock<std::mutex> lock(mut);
+      if (!free.empty()) {
+        block = std::move(free.back());
+        free.pop_back();
+      }
+    }
+    if (!block)
+      block.reset(new std::vector<uint8_t>(block_size));
+
+    // the deleter runs after the last reference is dropped, which
+    // shared_ptr orders after all uses of the block through other references
+    return std::shared_ptr<std::vector<uint8_t>>(
+        block.release(), Recycler{shared_from_this()});
+  }
+
+private:
+  struct Recycler {
+    /// keeps the pool alive until every block has been returned
+    std::shared_ptr<BlockPool> pool;
+
+    void operator()(std::vector<uint8_t> *block) const {
+      std::unique_ptr<std::vector<uint8_t>> owned(block);
+      std::unique_lock<std::mutex> lock(pool->mut);
+      if (pool->free.size() < pool->max_free)
+        pool->free.push_back(std::move(owned));
+    }
+  };
+
+  size_t block_size;
+  size_t max_free;
+  std::mutex mut;
+  std::vector<std::unique_ptr<std::vector<uint8_t>>> free;
+};
+
+/// Reads batches of up to batch_size datagrams with one recvmmsg call. Each
+/// batch is read into one block of memory from a BlockPool, so blocks are
+/// reused once all of the datagrams in them have been freed, however long the
+/// consumer holds on to them. Datagrams larger than max_datagram_size are
+/// dropped.
+class DatagramReader {
+public:
+  /// the number of unused blocks to keep
+  static constexpr size_t max_free_blocks = 8;
+
+  DatagramReader(size_t batch_size, size_t max_datagram_size)
+      : batch_size(batch_size), max_datagram_size(max_datagram_size),
+        pool(std::make_shared<BlockPool>(batch_size * max_datagram_size,
+                                         max_free_blocks)),
+        msgs(batch_size), iovs(batch_size), addrs(batch_size) {}
+
+  /// read datagrams into batch, returning the number of bytes read, or -1 if
+  /// the socket was closed, in which case reason is set
+  ssize_t read(int fd, std::vector<Datagram> &batch, CloseReason &reason) {
+    // the block is kept while it is unused, for example after EAGAIN
+    if (!block || !block_unused)
+      block = pool->get();
+    block_unused = true;
+
+    for (size_t i = 0; i < batch_size; i++) {
+      iovs[i].iov_base = block->data() + i * max_datagram_size;
+      iovs[i].iov_len = max_datagram_size;
+
+      memset(&msgs[i], 0, sizeof(msgs[i]));
+      msgs[i].msg_hdr.msg_iov = &iovs[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+      msgs[i].msg_hdr.msg_name = &addrs[i];
+      msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+    }
+
+    int n = recvmmsg(fd, msgs.data(), batch_size, MSG_WAITFORONE, NULL);
+    if (n < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+        return 0;
+      reason = CloseReason::Error;
+      return -1;
+    }
+
+    // shutdown() wakes the reader with an empty message with no source
+    if (n == 0 ||
+        (msgs[0].msg_len == 0 && msgs[0].msg_hdr.msg_namelen == 0)) {
+      reason = CloseReason::Normal;
+      return -1;
+    }
+
+    batch.reserve(batch.size() + n);
+    size_t bytes = 0;
+    for (int i = 0; i < n; i++) {
+      if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC)
+        continue;
+
+      Datagram datagram;
+      memcpy(&datagram.address.addr, &addrs[i], msgs[i].msg_hdr.msg_namelen);
+      datagram.address.addrlen = msgs[i].msg_hdr.msg_namelen;
+      datagram.address.family = addrs[i].ss_family;
+      datagram.address.socktype = SOCK_DGRAM;
+      datagram.address.protocol = 0;
+      datagram.data = Buffer(block, i * max_datagram_size, msgs[i].msg_len);
+      block_unused = false;
+
+      bytes += msgs[i].msg_len;
+      batch.push_back(std::move(datagram));
+    }
+
+    return bytes;
+  }
+
+private:
+  size_t batch_size;
+  size_t max_datagram_size;
+
+  std::shared_ptr<BlockPool> pool;
+  std::shared_ptr<std::vector<uint8_t>> block;
+  /// are no Buffers made from block?
+  bool block_unused = false;
+  std::vector<struct mmsghdr> msgs;
+  std::vector<struct iovec> iovs;
+  std::vector<struct sockaddr_storage> addrs;
+};
+
+/// Receiver which pushes each batch read by a DatagramReader into a channel
+class DatagramReceiver {
+public:
+  DatagramReceiver(Channel<std::vector<Datagram>> on_message,
+                   size_t batch_size, size_t max_datagram_size)
+      : on_message(std::move(on_message)),
+        reader(batch_size, max_datagram_size) {}
+
+  ssize_t receive(int fd, CloseReason &reason) {
+    std::vector<Datagram> batch;
+    ssize_t bytes = reader.read(fd, batch, reason);
+    if (!batch.empty())
+      on_message.push(std::move(batch));
+    return bytes;
+  }
+
+private:
+  Channel<std::vector<Datagram>> on_message;
+  DatagramReader reader;
+};
+} // namespace detail
+
+/// Actor which reads datagrams from a UDP socket in batches of up to
+/// batch_size per system call, and pushes each batch to on_message. Datagrams
+/// larger than max_datagram_size are dropped. on_close is pushed to if the
+/// socket is shut down or fails.
+class DatagramRecvThread
+    : public detail::RecvThreadBase<detail::DatagramReceiver> {
+public:
+  DatagramRecvThread(int fd, Channel<std::vector<Datagram>> on_message,
+                     Channel<CloseReason> on_close, size_t batch_size = 64,
+                     size_t max_datagram_size = 2048,
+                     ByteBudget budget = ByteBudget())
+      : RecvThreadBase(fd,
+                       detail::DatagramReceiver(std::move(on_message),
+                                                batch_size, max_datagram_size),
+                       std::move(on_close), std::move(budget)) {}
+};
+
+} // namespace ACTORPP_CONFIG_NAMESPACE
+} // namespace actorpp
@@ -0,0 +1,263 @@
+#pragma once
+#include "actor.hpp"
+#include "net.hpp"
+#include <stdexcept>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+
+namespace actorpp {
+inline namespace ACTORPP_CONFIG_NAMESPACE {
+
+namespace detail {
+inline struct sockaddr_un unix_address(const std::string &path) {
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path))
+    throw std::runtime_error("unix socket path too long");
+  memcpy(addr.sun_path, path.data(), path.size());
+  return addr;
+}
+
+/// UnixMessage boundaries are only kept by SOCK_SEQPACKET sockets
+inline void check_seqpacket(int fd) {
+  int type;
+  socklen_t len = sizeof(type);
+  if (getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &len) != 0)
+    throw std::runtime_error("getsockopt() failed");
+  if (type != SOCK_SEQPACKET)
+    throw std::logic_error("UnixMessage requires a SOCK_SEQPACKET socket");
+}
+} // namespace detail
+
+/// connect to a unix socket at path. type is SOCK_STREAM (the default) for a
+/// byte stream which can be used in the same way as a socket returned by
+/// connect, or SOCK_SEQPACKET for use with UnixMessage
+inline int connect_unix(const std::string &path, int type = SOCK_STREAM) {
+  struct sockaddr_un addr = detail::unix_address(path);
+
+  int sockfd = socket(AF_UNIX, type, 0);
+  if (sockfd < 0)
+    throw std::runtime_error("failed to allocate socket");
+
+  if (::connect(sockfd, (const struct sockaddr *)&addr, sizeof(addr)) != 0) {
+    close(sockfd);
+    throw std::runtime_error("failed to connect");
+  }
+
+  return sockfd;
+}
+
+/// create a unix socket listening at path; connections are accepted with
+/// accept. path must not already exist. type is as for connect_unix, and must
+/// match the type used by clients.
+inline int listen_unix(const std::string &path, int backlog = 16,
+                       int type = SOCK_STREAM) {
+  struct sockaddr_un addr = detail::unix_address(path);
+
+  int sockfd = socket(AF_UNIX, type, 0);
+  if (sockfd < 0)
+    throw std::runtime_error("failed to allocate socket");
+
+  if (bind(sockfd, (const struct sockaddr *)&addr, sizeof(addr)) != 0) {
+    close(sockfd);
+    throw std::runtime_error("failed to bind");
+  }
+
+  if (::listen(sockfd, backlog) != 0) {
+    close(sockfd);
+    throw std::runtime_error("failed to listen");
+  }
+
+  return sockfd;
+}
+
+/// Data and file descriptors sent or received over a unix socket. These are
+/// only used with SOCK_SEQPACKET sockets (pass SOCK_SEQPACKET to connect_unix
+/// and listen_unix), so that each message sent is received as one
+/// UnixMessage; on a SOCK_STREAM socket, messages could be split or joined.
+struct UnixMessage {
+  std::vector<uint8_t> data;
+  std::vector<int> fds;
+};
+
+/// the maximum number of file descriptors in one UnixMessage
+constexpr size_t unix_message_max_fds = 16;
+
+/// the maximum size of the data in one UnixMessage
+constexpr size_t unix_message_max_size = 65536;
+
+/// send data and file descriptors (with SCM_RIGHTS) over a SOCK_SEQPACKET unix
+/// socket, as a single message. The descriptors are duplicated into the
+/// receiving process, and are not closed. data must not be empty, as an empty
+/// message can't be told apart from the socket being closed.
+inline void send_message(int fd, const UnixMessage &message) {
+  if (message.fds.size() > unix_message_max_fds)
+    throw std::logic_error("too many fds in UnixMessage");
+  if (message.data.empty())
+    throw std::logic_error("UnixMessage must contain data");
+  if (message.data.size() > unix_message_max_size)
+    throw std::logic_error("UnixMessage data too large");
+
+  struct iovec iov;
+  iov.iov_base = (void *)message.data.data();
+  iov.iov_len = message.data.size();
+
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+
+  union {
+    struct cmsghdr align;
+    char buf[CMSG_SPACE(sizeof(int) * unix_message_max_fds)];
+  } control;
+  if (!message.fds.empty()) {
+    memset(&control, 0, sizeof(control));
+    msg.msg_control = control.buf;
+    msg.msg_controllen = CMSG_SPACE(sizeof(int) * message.fds.size());
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * message.fds.size());
+    memcpy(CMSG_DATA(cmsg), message.fds.data(),
+           sizeof(int) * message.fds.size());
+  }
+
+  // a SOCK_SEQPACKET socket sends the whole message or nothing
+  if (sendmsg(fd, &msg, MSG_NOSIGNAL) != (ssize_t)message.data.size())
+    throw std::runtime_error("sendmsg() failed");
+}
+
+namespace detail {
+/// Receiver which pushes each message, with any received file descriptors,
+/// into a channel
+class UnixReceiver {
+public:
+  UnixReceiver(Channel<UnixMessage> on_message)
+      : on_message(std::move(on_message)), buf(unix_message_max_size) {}
+
+  ssize_t receive(int fd, CloseReason &reason) {
+    struct iovec iov;
+    iov.iov_base = buf.data();
+    iov.iov_len = buf.size();
+
+    union {
+      struct cmsghdr align;
+      char buf[CMSG_SPACE(sizeof(int) * unix_message_max_fds)];
+    } control;
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    ssize_t bytes_read = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+    if (bytes_read <= 0) {
+      reason = CloseReason::Normal;
+      return -1;
+    }
+
+    UnixMessage message;
+    message.data.assign(buf.begin(), buf.begin() + bytes_read);
+
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+        size_t n_fds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        size_t offset = message.fds.size();
+        message.fds.resize(offset + n_fds);
+        memcpy(message.fds.data() + offset, CMSG_DATA(cmsg),
+               sizeof(int) * n_fds);
+      }
+    }
+
+    // some descriptors or data were dropped, so the stream can't be trusted
+    if (msg.msg_flags & (MSG_CTRUNC | MSG_TRUNC)) {
+      for (int received_fd : message.fds)
+        close(received_fd);
+      reason = CloseReason::Error;
+      return -1;
+    }
+
+    on_message.push(std::move(message));
+    return bytes_read;
+  }
+
+private:
+  Channel<UnixMessage> on_message;
+  std::vector<uint8_t> buf;
+};
+} // namespace detail
+
+/// Actor which pushes each message received from a SOCK_SEQPACKET unix socket
+/// into on_message, and pushes to on_close when the socket is closed. Received
+/// file descriptors are owned by the reader of on_message. budget counts the
+/// data bytes in each message.
+class UnixRecvThread : public detail::RecvThreadBase<detail::UnixReceiver> {
+public:
+  UnixRecvThread(int fd, Channel<UnixMessage> on_message,
+                 Channel<CloseReason> on_close,
+                 ByteBudget budget = ByteBudget())
+      : RecvThreadBase((detail::check_seqpacket(fd), fd),
+                       detail::UnixReceiver(std::move(on_message)),
+                       std::move(on_close), std::move(budget)) {}
+};
+
+/// Actor which sends messages pushed to `messages` over a SOCK_SEQPACKET unix
+/// socket with send_message. The file descriptors in each message are closed
+/// once it has been sent. If sending fails, CloseReason::Error is pushed to
+/// on_close, and no more messages are sent.
+class UnixSendThread : public Actor {
+public:
+  UnixSendThread(int fd, Channel<CloseReason> on_close)
+      : messages(*this), fd(fd), on_close(std::move(on_close)),
+        do_exit(*this) {
+    detail::check_seqpacket(fd);
+  }
+
+  Channel<UnixMessage> messages;
+
+  void run() {
+    while (true) {
+      switch (wait(messages, do_exit)) {
+      case 0: {
+        UnixMessage message = messages.pop();
+        bool ok = true;
+        try {
+          send_message(fd, message);
+        } catch (const std::runtime_error &) {
+          ok = false;
+        }
+        for (int message_fd : message.fds)
+          close(message_fd);
+
+        if (!ok) {
+          on_close.push(CloseReason::Error);
+          return;
+        }
+      } break;
+      case 1:
+        if (do_exit.pop())
+          return;
+        break;
+      }
+    }
+  }
+
+  void exit() { do_exit.push(true); }
+
+private:
+  int fd;
+  Channel<CloseReason> on_close;
+  Channel<bool> do_exit;
+};
+
+} // namespace ACTORPP_CONFIG_NAMESPACE
+} // namespace actorpp
@@ -0,0 +1,133 @@
+#pragma once
+#include "actor.hpp"
+#include <chrono>
+#include <map>
+#include <stdint.h>
+#include <string>
+
+#ifndef ACTORPP_WATCHDOG
+#error "watchdog.hpp requires ACTORPP_WATCHDOG to be defined"
+#endif
+
+namespace actorpp {
+inline namespace ACTORPP_CONFIG_NAMESPACE {
+
+/// a channel whose oldest element has been waiting for too long, or an actor
+/// which has not returned to wait for too long
+struct StallEvent {
+  enum class Kind { Channel, Actor };
+  Kind kind;
+  /// the age of the oldest element in the channel, or the time since the actor
+  /// last returned from a wait
+  uint64_t age_ns;
+  /// the stalled channel, for Channel events
+  uint64_t channel_id;
+  std::string channel_name;
+  /// the stalled actor, or the actor associated with the stalled channel if
+  /// there is one
+  bool has_actor;
+  uint64_t actor_id;
+  std::string actor_name;
+};
+
+/// Actor which periodically checks all live channels and actors for stalls,
+/// pushing a StallEvent to on_stall when:
+///
+/// - the oldest element in a channel is older than max_age
+/// - an actor which has waited before has spent longer than max_age since
+///   last returning from a wait, for example because a message handler is
+///   stuck
+///
+/// Each stall is reported once: a channel is reported again only once its
+/// oldest element has been popped, and an actor only once it has waited
+/// again.
+///
+/// This uses the counters enabled by ACTORPP_WATCHDOG (which turns on
+/// ACTORPP_CHANNEL_STATS and ACTORPP_ACTOR_STATS), which are read without
+/// taking the locks of the channels or actors being checked.
+class Watchdog : public Actor {
+public:
+  Watchdog(Channel<StallEvent> on_stall,
+           std::chrono::nanoseconds max_age = std::chrono::milliseconds(50),
+           std::chrono::nanoseconds period = std::chrono::milliseconds(10))
+      : on_stall(std::move(on_stall)), do_exit(*this),
+        max_age_ns(max_age.count()), period(period) {
+    set_name("Watchdog");
+  }
+
+  void run() {
+    while (true) {
+      if (wait_for(period, do_exit) == 0 && do_exit.pop())
+        return;
+      check();
+    }
+  }
+
+  void exit() { do_exit.push(true); }
+
+  /// check all channels and actors once; this is called by run, but is public
+  /// so that the watchdog can be used without a thread
+  void check() {
+    std::map<uint64_t, std::string> actor_names;
+    std::map<uint64_t, uint64_t> actors_stalled;
+    for (const ActorStats &stats : actor_stats()) {
+      actor_names[stats.id] = stats.name;
+      if (stats.since_wait_ns <= max_age_ns)
+        continue;
+
+      // waits identifies the stall, as it is incremented on every return
+      actors_stalled[stats.id] = stats.waits;
+      auto previous = actors_reported.find(stats.id);
+      if (previous != actors_reported.end() && previous->second == stats.waits)
+        continue;
+
+      StallEvent event;
+      event.kind = StallEvent::Kind::Actor;
+      event.age_ns = stats.since_wait_ns;
+      event.channel_id = 0;
+      event.has_actor = true;
+      event.actor_id = stats.id;
+      event.actor_name = stats.name;
+      on_stall.push(std::move(event));
+    }
+    actors_reported = std::move(actors_stalled);
+
+    std::map<uint64_t, uint64_t> channels_stalled;
+    for (const ChannelStats &stats : channel_stats()) {
+      if (stats.head_age_ns <= max_age_ns)
+        continue;
+
+      // popped identifies the oldest element
+      channels_stalled[stats.id] = stats.popped;
+      auto previous = channels_reported.find(stats.id);
+      if (previous != channels_reported.end() &&
+          previous->second == stats.popped)
+        continue;
+
+      StallEvent event;
+      event.kind = StallEvent::Kind::Channel;
+      event.age_ns = stats.head_age_ns;
+      event.channel_id = stats.id;
+      event.channel_name = stats.name;
+      event.has_actor = stats.has_actor;
+      event.actor_id = stats.actor_id;
+      event.actor_name = stats.has_actor ? actor_names[stats.actor_id] : "";
+      on_stall.push(std::move(event));
+    }
+    channels_reported = std::move(channels_stalled);
+  }
+
+private:
+  Channel<StallEvent> on_stall;
+  Channel<bool> do_exit;
+  uint64_t max_age_ns;
+  std::chrono::nanoseconds period;
+
+  /// the stalls reported in the last check: the waits count for actors, and
+  /// the popped count for channels
+  std::map<uint64_t, uint64_t> actors_reported;
+  std::map<uint64_t, uint64_t> channels_reported;
+};
+
+} // namespace ACTORPP_CONFIG_NAMESPACE
+} // namespace actorpp
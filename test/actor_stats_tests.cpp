@@ -0,0 +1,108 @@
+#include "actorpp/actor.hpp"
+#include "catch2/catch.hpp"
+#include <pthread.h>
+#include <thread>
+#include <time.h>
+
+using namespace actorpp;
+using namespace std::chrono_literals;
+
+static const ActorStats *find(const std::vector<ActorStats> &stats,
+                              const std::string &name) {
+  for (const ActorStats &s : stats)
+    if (s.name == name)
+      return &s;
+  return nullptr;
+}
+
+static std::string thread_name() {
+  char name[16];
+  pthread_getname_np(pthread_self(), name, sizeof(name));
+  return name;
+}
+
+static uint64_t thread_cpu_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/// spins for 50ms of CPU time (not wall time, as the thread may not be
+/// scheduled while the tests run in parallel), sends its thread name, then
+/// waits to exit
+class Spinner : public Actor {
+public:
+  Spinner(Channel<std::string> names) : names(names), do_exit(*this) {}
+
+  void run() {
+    uint64_t start = thread_cpu_ns();
+    while (thread_cpu_ns() - start < 50000000)
+      ;
+    names.push(thread_name());
+    wait(do_exit);
+    names.push(thread_name());
+  }
+
+  void exit() { do_exit.push(true); }
+
+private:
+  Channel<std::string> names;
+  Channel<bool> do_exit;
+};
+
+TEST_CASE("blocked time") {
+  Actor self;
+  self.set_name("self");
+  Channel<int> ints(self);
+
+  REQUIRE(self.wait_for(50ms, ints) == -1);
+
+  std::thread pusher([&] {
+    std::this_thread::sleep_for(50ms);
+    ints.push(1);
+  });
+  REQUIRE(ints.read() == 1);
+  pusher.join();
+
+  ActorStats stats = self.stats();
+  REQUIRE(stats.name == "self");
+  REQUIRE(stats.waits == 2);
+  REQUIRE(stats.blocked_ns >= 100000000);
+  REQUIRE(stats.blocked_ns <= stats.wall_ns);
+  REQUIRE(stats.running_ns == stats.wall_ns - stats.blocked_ns);
+  REQUIRE(stats.utilisation() < 0.5);
+  REQUIRE(stats.cpu_ns == 0);
+}
+
+TEST_CASE("actor thread") {
+  Channel<std::string> names;
+  uint64_t id;
+  {
+    ActorThread<Spinner> spinner(names);
+    REQUIRE(names.read() == "Spinner");
+
+    ActorStats stats = spinner.stats();
+    id = stats.id;
+    REQUIRE(stats.name == "Spinner");
+    REQUIRE(stats.cpu_ns >= 50000000);
+    REQUIRE(stats.running_ns >= 50000000);
+
+    std::vector<ActorStats> all = actor_stats();
+    const ActorStats *found = find(all, "Spinner");
+    REQUIRE(found);
+    REQUIRE(found->id == id);
+
+    spinner.set_name("renamed spinner thread");
+    REQUIRE(spinner.stats().name == "renamed spinner thread");
+  }
+  REQUIRE(names.read() == "renamed spinner");
+
+  for (const ActorStats &stats : actor_stats())
+    REQUIRE(stats.id != id);
+}
+
+TEST_CASE("channels without actors are not registered") {
+  size_t before = actor_stats().size();
+  Channel<int> ints;
+  REQUIRE(actor_stats().size() == before);
+}
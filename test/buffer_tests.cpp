@@ -0,0 +1,53 @@
+#include "actorpp/buffer.hpp"
+#include "catch2/catch.hpp"
+#include <string>
+
+using namespace actorpp;
+
+static Buffer str_buffer(const std::string &s) {
+  return Buffer(s.data(), s.size());
+}
+
+static std::string to_string(const Buffer &buffer) {
+  return std::string((const char *)buffer.data(), buffer.size());
+}
+
+TEST_CASE("buffer slice") {
+  Buffer buffer = str_buffer("hello world");
+  Buffer world = buffer.slice(6);
+  Buffer lo = buffer.slice(3, 2);
+
+  REQUIRE(to_string(world) == "world");
+  REQUIRE(to_string(lo) == "lo");
+  REQUIRE(world.data() == buffer.data() + 6);
+  REQUIRE(to_string(world.slice(1, 3)) == "orl");
+  REQUIRE(buffer.slice(11).empty());
+
+  REQUIRE_THROWS_AS(buffer.slice(12), std::out_of_range);
+  REQUIRE_THROWS_AS(buffer.slice(6, 6), std::out_of_range);
+}
+
+TEST_CASE("buffer chain") {
+  BufferChain chain;
+  chain.append(str_buffer("hello "));
+  chain.append(Buffer());
+  chain.append(str_buffer("wor"));
+  chain.append(str_buffer("ld"));
+  REQUIRE(chain.size() == 11);
+  REQUIRE(chain.buffers().size() == 3);
+
+  BufferChain middle = chain.slice(4, 5);
+  REQUIRE(middle.buffers().size() == 2);
+  REQUIRE(to_string(middle.flatten()) == "o wor");
+
+  char buf[4];
+  chain.copy_to(5, buf, 4);
+  REQUIRE(std::string(buf, 4) == " wor");
+
+  chain.consume(7);
+  REQUIRE(to_string(chain.flatten()) == "orld");
+  REQUIRE(chain.buffers().size() == 2);
+
+  BufferChain single(str_buffer("abc"));
+  REQUIRE(single.flatten().data() == single.buffers()[0].data());
+}
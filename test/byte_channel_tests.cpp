@@ -0,0 +1,85 @@
+#include "actorpp/actor.hpp"
+#include "actorpp/byte_channel.hpp"
+#include "catch2/catch.hpp"
+#include <string>
+
+using namespace actorpp;
+
+static std::string to_string(ByteSpan span) {
+  return std::string((const char *)span.data, span.size);
+}
+
+TEST_CASE("byte channel contiguous across wrap") {
+  ByteChannel bytes(1);
+  size_t capacity = bytes.capacity();
+  REQUIRE(capacity >= 1);
+
+  std::string first(capacity - 2, 'a');
+  bytes.write(first.data(), first.size());
+  REQUIRE(bytes.peek().size == first.size());
+  bytes.consume(first.size());
+  REQUIRE(!bytes.readable());
+
+  bytes.write("hello", 5);
+  bytes.write(" world", 6);
+  REQUIRE(to_string(bytes.peek()) == "hello world");
+
+  bytes.consume(6);
+  REQUIRE(to_string(bytes.peek()) == "world");
+}
+
+TEST_CASE("byte channel try_write and reserve") {
+  ByteChannel bytes(1);
+  std::string fill(bytes.capacity() - 3, 'x');
+  bytes.write(fill.data(), fill.size());
+
+  REQUIRE(bytes.try_write("abcdef", 6) == 3);
+  REQUIRE(bytes.reserve().size == 0);
+
+  bytes.consume(fill.size());
+  MutableByteSpan space = bytes.reserve();
+  REQUIRE(space.size == fill.size());
+  memcpy(space.data, "ghi", 3);
+  bytes.commit(3);
+  REQUIRE(to_string(bytes.peek()) == "abcghi");
+
+  REQUIRE_THROWS_AS(bytes.consume(7), std::logic_error);
+}
+
+class ByteWriter : public Actor {
+public:
+  ByteWriter(ByteChannel bytes, std::string data)
+      : bytes(std::move(bytes)), data(std::move(data)) {}
+
+  void run() {
+    for (size_t i = 0; i < data.size(); i += 1000)
+      bytes.write(data.data() + i, std::min<size_t>(1000, data.size() - i));
+  }
+
+  void exit() {}
+
+private:
+  ByteChannel bytes;
+  std::string data;
+};
+
+TEST_CASE("byte channel wait") {
+  Actor self;
+  Channel<bool> other(self);
+  ByteChannel bytes(self, 4096);
+
+  std::string data;
+  for (int i = 0; data.size() < 4 * bytes.capacity(); i++)
+    data += std::to_string(i) + ",";
+
+  ActorThread<ByteWriter> writer(bytes, data);
+
+  std::string received;
+  while (received.size() < data.size()) {
+    REQUIRE(self.wait(other, bytes) == 1);
+    ByteSpan span = bytes.peek();
+    received += to_string(span);
+    bytes.consume(span.size);
+  }
+  REQUIRE(received == data);
+}
@@ -0,0 +1,47 @@
+#include "actorpp/crc32c.hpp"
+#include "catch2/catch.hpp"
+#include <random>
+#include <vector>
+
+using namespace actorpp;
+
+TEST_CASE("crc32c check values") {
+  REQUIRE(crc32c("", 0) == 0);
+  REQUIRE(crc32c("123456789", 9) == 0xe3069283);
+  REQUIRE(detail::crc32c_sw((const uint8_t *)"123456789", 9, 0) ==
+          0xe3069283);
+
+  std::vector<uint8_t> zeros(32, 0);
+  REQUIRE(crc32c(zeros.data(), zeros.size()) == 0x8a9136aa);
+}
+
+TEST_CASE("crc32c in parts") {
+  std::mt19937 rng(1);
+  std::vector<uint8_t> data(1000);
+  for (uint8_t &byte : data)
+    byte = rng();
+
+  uint32_t whole = crc32c(data.data(), data.size());
+  for (size_t split = 0; split <= data.size(); split += 37) {
+    uint32_t crc = crc32c(data.data(), split);
+    REQUIRE(crc32c(data.data() + split, data.size() - split, crc) == whole);
+  }
+}
+
+#ifdef ACTORPP_CRC32C_SSE42
+TEST_CASE("crc32c hardware matches software") {
+  if (!detail::crc32c_hw_supported())
+    return;
+
+  std::mt19937 rng(2);
+  std::vector<uint8_t> data(300);
+  for (uint8_t &byte : data)
+    byte = rng();
+
+  // all short lengths, at all alignments
+  for (size_t offset = 0; offset < 8; offset++)
+    for (size_t size = 0; offset + size <= data.size(); size++)
+      REQUIRE(detail::crc32c_hw(data.data() + offset, size, 5) ==
+              detail::crc32c_sw(data.data() + offset, size, 5));
+}
+#endif
@@ -0,0 +1,43 @@
+#include "actorpp/actor.hpp"
+#include "catch2/catch.hpp"
+#include <thread>
+
+using namespace actorpp;
+using namespace std::chrono_literals;
+
+TEST_CASE("channel sojourn time") {
+  Actor self;
+  Channel<int> ints(self);
+
+  ints.push(1);
+  std::this_thread::sleep_for(20ms);
+  ints.pop();
+
+  ints.push(2);
+  ints.pop();
+
+  Histogram sojourn = ints.stats().sojourn_ns;
+  REQUIRE(sojourn.count() == 2);
+  REQUIRE(sojourn.percentile(50) < 10000000);
+  REQUIRE(sojourn.max() >= 20000000);
+  REQUIRE(sojourn.percentile(100) == sojourn.max());
+}
+
+TEST_CASE("cleared elements are not sojourn samples") {
+  Actor self;
+  Channel<int> ints(self);
+  REQUIRE(ints.stats().sojourn_ns.count() == 0);
+
+  ints.push(1);
+  ints.push(2);
+  ints.clear();
+
+  ChannelStats stats = ints.stats();
+  REQUIRE(stats.depth == 0);
+  REQUIRE(stats.head_age_ns == 0);
+  REQUIRE(stats.sojourn_ns.count() == 0);
+
+  ints.push(3);
+  REQUIRE(ints.pop() == 3);
+  REQUIRE(ints.stats().sojourn_ns.count() == 1);
+}
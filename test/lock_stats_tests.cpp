@@ -0,0 +1,99 @@
+#include "actorpp/actor.hpp"
+#include "actorpp/byte_channel.hpp"
+#include "catch2/catch.hpp"
+#include <atomic>
+#include <sstream>
+#include <thread>
+
+using namespace actorpp;
+using namespace std::chrono_literals;
+
+/// replies to each number with the same number
+class Echo : public Actor {
+public:
+  Echo(Channel<int> out) : in(*this), out(out) {}
+
+  void run() {
+    while (true) {
+      int value = in.read();
+      if (value < 0)
+        return;
+      out.push(value);
+    }
+  }
+
+  void exit() { in.push(-1); }
+
+  Channel<int> in;
+
+private:
+  Channel<int> out;
+};
+
+TEST_CASE("contended lock") {
+  Actor self;
+  self.set_name("contended");
+  Channel<int> ints(self);
+
+  LockStats before = self.lock_stats();
+  REQUIRE(before.name == "contended");
+  REQUIRE(before.contended == 0);
+
+  // hold the lock for 20ms from when the pusher is about to take it, so that
+  // it waits for most of that even if the thread starts late
+  std::atomic<bool> pushing(false);
+  std::thread pusher;
+  {
+    detail::ActorImpl::Lock lock(self.impl->mut);
+    pusher = std::thread([&] {
+      pushing = true;
+      ints.push(1);
+    });
+    while (!pushing)
+      std::this_thread::yield();
+    std::this_thread::sleep_for(20ms);
+  }
+  pusher.join();
+  REQUIRE(ints.read() == 1);
+
+  LockStats after = self.lock_stats();
+  REQUIRE(after.acquisitions >= before.acquisitions + 3);
+  REQUIRE(after.contended == 1);
+  REQUIRE(after.wait_ns >= 10000000);
+  REQUIRE(after.max_wait_ns == after.wait_ns);
+  REQUIRE(after.max_hold_ns >= 20000000);
+
+  std::vector<LockStats> top = most_contended_locks(1);
+  REQUIRE(top.size() == 1);
+  REQUIRE(top[0].id == after.id);
+
+  std::ostringstream report;
+  write_lock_report(report);
+  REQUIRE(report.str().find("contended") != std::string::npos);
+}
+
+TEST_CASE("actor thread lock names") {
+  Actor self;
+  Channel<int> replies(self);
+  ActorThread<Echo> echo(replies);
+
+  echo.in.push(5);
+  REQUIRE(replies.read() == 5);
+  REQUIRE(echo.lock_stats().name == "Echo");
+  REQUIRE(echo.lock_stats().acquisitions >= 2);
+}
+
+TEST_CASE("byte channel with profiled lock") {
+  ByteChannel bytes(1);
+  std::string fill(bytes.capacity(), 'x');
+  bytes.write(fill.data(), fill.size());
+
+  std::thread reader([&] {
+    std::this_thread::sleep_for(10ms);
+    bytes.consume(bytes.peek().size);
+  });
+  // blocks on space_cv until the reader consumes
+  bytes.write("y", 1);
+  reader.join();
+  REQUIRE(bytes.peek().size == 1);
+}
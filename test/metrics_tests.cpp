@@ -0,0 +1,100 @@
+#include "actorpp/actor.hpp"
+#include "actorpp/metrics.hpp"
+#include "catch2/catch.hpp"
+#include <regex>
+#include <sstream>
+#include <string>
+
+using namespace actorpp;
+
+/// make a request to the exporter, returning the whole response
+static std::string http_request(int port, const std::string &request) {
+  int fd = connect("localhost", port);
+  send_all(fd, BufferChain(Buffer(request.data(), request.size())));
+
+  std::string response;
+  char buf[4096];
+  ssize_t n;
+  while ((n = recv(fd, buf, sizeof(buf), 0)) > 0)
+    response.append(buf, n);
+  close(fd);
+  return response;
+}
+
+static std::string get(int port, const std::string &path) {
+  return http_request(port, "GET " + path +
+                                " HTTP/1.1\r\nHost: localhost\r\n\r\n");
+}
+
+static bool contains(const std::string &s, const std::string &part) {
+  return s.find(part) != std::string::npos;
+}
+
+TEST_CASE("metrics text") {
+  Actor self;
+  self.set_name("self");
+  Channel<int> ints(self);
+  ints.set_name("i\"n\\t\ns");
+  ints.push(1);
+  ints.push(2);
+  ints.pop();
+
+  std::string metrics = prometheus_metrics();
+  std::string labels = "{id=\"" + std::to_string(ints.stats().id) +
+                       "\",name=\"i\\\"n\\\\t\\ns\"}";
+  REQUIRE(contains(metrics, "# TYPE actorpp_channel_depth gauge\n"));
+  REQUIRE(contains(metrics, "actorpp_channel_depth" + labels + " 1\n"));
+  REQUIRE(contains(metrics, "actorpp_channel_pushed_total" + labels + " 2\n"));
+  REQUIRE(contains(metrics, "actorpp_channel_popped_total" + labels + " 1\n"));
+  REQUIRE(contains(metrics, "actorpp_channel_sojourn_seconds_count" + labels +
+                                " 1\n"));
+  REQUIRE(contains(metrics, "actorpp_actor_waits_total{id=\"" +
+                                std::to_string(self.stats().id) +
+                                "\",name=\"self\"} 0\n"));
+  REQUIRE(contains(metrics, "actorpp_actor_threads 0\n"));
+  REQUIRE(contains(metrics, "# TYPE actorpp_lock_contended_total counter\n"));
+
+  // every line is a comment or a sample
+  std::regex line_re("# (HELP|TYPE) [a-z_]+ .+|"
+                     "[a-z_]+(\\{([a-z]+=\"([^\"\\\\]|\\\\.)*\",?)+\\})? "
+                     "[0-9]+(\\.[0-9]{9})?");
+  std::istringstream lines(metrics);
+  std::string line;
+  while (std::getline(lines, line))
+    REQUIRE(std::regex_match(line, line_re));
+}
+
+TEST_CASE("metrics exporter") {
+  ActorThread<MetricsExporter> exporter;
+
+  Channel<int> ints;
+  ints.set_name("ints");
+  ints.push(1);
+  ints.push(2);
+
+  std::string response = get(exporter.port(), "/metrics");
+  REQUIRE(response.compare(0, 15, "HTTP/1.1 200 OK") == 0);
+  REQUIRE(contains(response, "\r\nContent-Type: text/plain; version=0.0.4"));
+
+  std::string body = response.substr(response.find("\r\n\r\n") + 4);
+  REQUIRE(contains(response, "\r\nContent-Length: " +
+                                 std::to_string(body.size()) + "\r\n"));
+  REQUIRE(contains(body, "actorpp_channel_depth{id=\"" +
+                             std::to_string(ints.stats().id) +
+                             "\",name=\"ints\"} 2\n"));
+  // the exporter itself is running
+  REQUIRE(contains(body, "actorpp_actor_threads 1\n"));
+  REQUIRE(contains(body, ",name=\"MetricsExporter\"} "));
+
+  // query strings are ignored
+  REQUIRE(get(exporter.port(), "/metrics?x=1").compare(0, 15,
+                                                       "HTTP/1.1 200 OK") == 0);
+  REQUIRE(get(exporter.port(), "/").compare(0, 12, "HTTP/1.1 404") == 0);
+  REQUIRE(http_request(exporter.port(), "POST /metrics HTTP/1.1\r\n\r\n")
+              .compare(0, 12, "HTTP/1.1 405") == 0);
+
+  // a client which closes before finishing its request doesn't stop the
+  // exporter
+  close(connect("localhost", exporter.port()));
+  REQUIRE(contains(get(exporter.port(), "/metrics"), "ints"));
+}
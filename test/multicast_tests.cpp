@@ -0,0 +1,202 @@
+#include "actorpp/actor.hpp"
+#include "actorpp/multicast.hpp"
+#include "catch2/catch.hpp"
+
+using namespace actorpp;
+
+static const char *group = "239.255.77.1";
+
+static int free_port() {
+  int fd = bind_udp("localhost", 0);
+  int port = local_port(fd);
+  close(fd);
+  return port;
+}
+
+static std::vector<MulticastMessage>
+read_messages(Actor &self, Channel<std::vector<MulticastMessage>> &on_message,
+              size_t n) {
+  std::vector<MulticastMessage> messages;
+  while (messages.size() < n) {
+    REQUIRE(self.wait_for(std::chrono::seconds(5), on_message) == 0);
+    for (MulticastMessage &message : on_message.pop())
+      messages.push_back(message);
+  }
+  return messages;
+}
+
+TEST_CASE("multicast fan-out") {
+  int port = free_port();
+  int fd_a = bind_multicast(group, port);
+  int fd_b = bind_multicast(group, port);
+
+  {
+    Actor self;
+    Channel<std::vector<MulticastMessage>> on_message_a(self);
+    Channel<std::vector<MulticastMessage>> on_message_b(self);
+    Channel<MulticastGap> on_gap(self);
+    Channel<CloseReason> on_close(self);
+
+    ActorThread<MulticastRecvThread> recv_a(fd_a, on_message_a, on_gap,
+                                            on_close);
+    ActorThread<MulticastRecvThread> recv_b(fd_b, on_message_b, on_gap,
+                                            on_close);
+
+    MulticastSender sender(group, port);
+    std::vector<Buffer> sent;
+    for (int i = 0; i < 10; i++) {
+      std::string s = "message " + std::to_string(i);
+      sent.push_back(Buffer(s.data(), s.size()));
+    }
+    sender.send(sent[0]);
+    sender.send(std::vector<Buffer>(sent.begin() + 1, sent.end()));
+    REQUIRE(sender.next_sequence() == 10);
+
+    for (auto *chan : {&on_message_a, &on_message_b}) {
+      std::vector<MulticastMessage> messages = read_messages(self, *chan, 10);
+      for (size_t i = 0; i < 10; i++) {
+        REQUIRE(messages[i].sender_id == sender.sender_id());
+        REQUIRE(messages[i].sequence == i);
+        REQUIRE(messages[i].data == sent[i]);
+      }
+    }
+    REQUIRE(!on_gap.readable());
+  }
+
+  close(fd_a);
+  close(fd_b);
+}
+
+TEST_CASE("multicast gaps") {
+  int port = free_port();
+  int fd = bind_multicast(group, port);
+
+  // send datagrams with hand-made headers, to simulate loss and reordering
+  int send_fd = socket(AF_INET, SOCK_DGRAM, 0);
+  struct in_addr interface = detail::ipv4_address("127.0.0.1");
+  REQUIRE(setsockopt(send_fd, IPPROTO_IP, IP_MULTICAST_IF, &interface,
+                     sizeof(interface)) == 0);
+  struct sockaddr_in dest;
+  memset(&dest, 0, sizeof(dest));
+  dest.sin_family = AF_INET;
+  dest.sin_addr = detail::ipv4_address(group);
+  dest.sin_port = htons(port);
+
+  {
+    Actor self;
+    Channel<std::vector<MulticastMessage>> on_message(self);
+    Channel<MulticastGap> on_gap(self);
+    Channel<CloseReason> on_close(self);
+
+    ActorThread<MulticastRecvThread> recv(fd, on_message, on_gap, on_close);
+
+    for (uint64_t sequence : {5, 6, 9, 7, 10}) {
+      uint8_t header[detail::multicast_header_size];
+      detail::write_multicast_header(header, 42, sequence);
+      REQUIRE(sendto(send_fd, header, sizeof(header), 0,
+                     (const struct sockaddr *)&dest, sizeof(dest)) ==
+              sizeof(header));
+    }
+
+    std::vector<MulticastMessage> messages =
+        read_messages(self, on_message, 4);
+    REQUIRE(messages[0].sequence == 5);
+    REQUIRE(messages[1].sequence == 6);
+    REQUIRE(messages[2].sequence == 9);
+    REQUIRE(messages[3].sequence == 10);
+
+    MulticastGap gap = on_gap.read();
+    REQUIRE(gap.sender_id == 42);
+    REQUIRE(gap.first_missing == 7);
+    REQUIRE(gap.count == 2);
+    REQUIRE(!on_gap.readable());
+  }
+
+  close(send_fd);
+  close(fd);
+}
+
+TEST_CASE("multicast sender limit") {
+  int port = free_port();
+  int fd = bind_multicast(group, port);
+
+  int send_fd = socket(AF_INET, SOCK_DGRAM, 0);
+  struct in_addr interface = detail::ipv4_address("127.0.0.1");
+  REQUIRE(setsockopt(send_fd, IPPROTO_IP, IP_MULTICAST_IF, &interface,
+                     sizeof(interface)) == 0);
+  struct sockaddr_in dest;
+  memset(&dest, 0, sizeof(dest));
+  dest.sin_family = AF_INET;
+  dest.sin_addr = detail::ipv4_address(group);
+  dest.sin_port = htons(port);
+
+  {
+    Actor self;
+    Channel<std::vector<MulticastMessage>> on_message(self);
+    Channel<MulticastGap> on_gap(self);
+    Channel<CloseReason> on_close(self);
+
+    ActorThread<MulticastRecvThread> recv(fd, on_message, on_gap, on_close, 64,
+                                          2048, 2);
+
+    // 3 replaces 2, which was heard from least recently, then 2 replaces 1,
+    // so only the gap from 3 is reported
+    std::vector<std::pair<uint32_t, uint64_t>> sent = {
+        {1, 5}, {2, 5}, {1, 6}, {3, 5}, {2, 9}, {3, 8}};
+    for (auto &id_sequence : sent) {
+      uint8_t header[detail::multicast_header_size];
+      detail::write_multicast_header(header, id_sequence.first,
+                                     id_sequence.second);
+      REQUIRE(sendto(send_fd, header, sizeof(header), 0,
+                     (const struct sockaddr *)&dest, sizeof(dest)) ==
+              sizeof(header));
+    }
+
+    std::vector<MulticastMessage> messages =
+        read_messages(self, on_message, sent.size());
+    REQUIRE(messages.size() == sent.size());
+
+    MulticastGap gap = on_gap.read();
+    REQUIRE(gap.sender_id == 3);
+    REQUIRE(gap.first_missing == 6);
+    REQUIRE(gap.count == 2);
+    REQUIRE(!on_gap.readable());
+  }
+
+  close(send_fd);
+  close(fd);
+}
+
+TEST_CASE("multicast byte budget") {
+  int port = free_port();
+  int fd = bind_multicast(group, port);
+
+  {
+    Actor self;
+    Channel<std::vector<MulticastMessage>> on_message(self);
+    Channel<MulticastGap> on_gap(self);
+    Channel<CloseReason> on_close(self);
+    ByteBudget budget(100, 50);
+
+    ActorThread<MulticastRecvThread> recv(fd, on_message, on_gap, on_close, 1,
+                                          2048, 1024, budget);
+
+    // reading stops after the message which reaches the high watermark
+    MulticastSender sender(group, port);
+    Buffer message(std::vector<uint8_t>(60, 'x'));
+    for (int i = 0; i < 4; i++)
+      sender.send(message);
+
+    std::vector<MulticastMessage> messages = read_messages(self, on_message, 2);
+    REQUIRE(messages.size() == 2);
+    REQUIRE(self.wait_for(std::chrono::milliseconds(100), on_message) == -1);
+    REQUIRE(budget.outstanding() == 120);
+
+    budget.consumed(120);
+    messages = read_messages(self, on_message, 2);
+    REQUIRE(messages.size() == 2);
+    REQUIRE(!on_gap.readable());
+  }
+
+  close(fd);
+}
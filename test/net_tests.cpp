@@ -1,13 +1,13 @@
-// run `python test/test_server.py` when running these tests!
-
 #include "actorpp/actor.hpp"
 #include "actorpp/net.hpp"
 #include "catch2/catch.hpp"
+#include "test_server.hpp"
 
 using namespace actorpp;
 
 TEST_CASE("ping pong") {
-  int fd = connect("localhost", 5001);
+  ActorThread<TestServer> server;
+  int fd = connect("localhost", server.port());
   {
     Actor self;
     Channel<std::vector<uint8_t>> on_message(self);
@@ -25,7 +25,8 @@ TEST_CASE("ping pong") {
 }
 
 TEST_CASE("exit") {
-  int fd = connect("localhost", 5001);
+  ActorThread<TestServer> server;
+  int fd = connect("localhost", server.port());
 
   {
     Actor self;
@@ -42,3 +43,169 @@ TEST_CASE("exit") {
 
   close(fd);
 }
+
+static int get_int_option(int fd, int level, int name) {
+  int value;
+  socklen_t len = sizeof(value);
+  REQUIRE(getsockopt(fd, level, name, &value, &len) == 0);
+  return value;
+}
+
+TEST_CASE("socket profiles") {
+  REQUIRE(socket_profile("low-latency").no_delay);
+  REQUIRE(socket_profile("bulk-throughput").recv_buffer > 0);
+  REQUIRE(!socket_profile("default").no_delay);
+  REQUIRE_THROWS_AS(socket_profile("fast"), std::logic_error);
+}
+
+TEST_CASE("socket options") {
+  SocketOptions bulk = SocketOptions::bulk_throughput();
+  bulk.recv_buffer = 65536;
+  int listen_fd = listen("localhost", 0, 16, bulk);
+  int port = local_port(listen_fd);
+
+  int client_fd = connect("localhost", port, SocketOptions::low_latency());
+  REQUIRE(get_int_option(client_fd, IPPROTO_TCP, TCP_NODELAY) == 1);
+  REQUIRE(get_int_option(client_fd, IPPROTO_TCP, TCP_USER_TIMEOUT) == 10000);
+  REQUIRE(get_int_option(client_fd, SOL_SOCKET, SO_KEEPALIVE) == 1);
+
+  int server_fd = accept(listen_fd, bulk);
+  REQUIRE(get_int_option(server_fd, SOL_SOCKET, SO_RCVBUF) >= 65536);
+  REQUIRE(get_int_option(server_fd, IPPROTO_TCP, TCP_NODELAY) == 0);
+
+  {
+    Actor self;
+    Channel<std::vector<uint8_t>> on_message(self);
+    Channel<CloseReason> on_close(self);
+
+    ActorThread<RecvThread> recv(server_fd, on_message, on_close,
+                                 SocketOptions::low_latency());
+    REQUIRE(get_int_option(server_fd, IPPROTO_TCP, TCP_NODELAY) == 1);
+
+    send(client_fd, "ping", 4, MSG_NOSIGNAL);
+    REQUIRE(self.wait(on_message, on_close) == 0);
+    std::vector<uint8_t> buf = on_message.pop();
+    REQUIRE(std::string((char *)buf.data(), buf.size()) == "ping");
+  }
+
+  close(client_fd);
+  close(server_fd);
+  close(listen_fd);
+}
+
+TEST_CASE("socket options failure doesn't leak fds") {
+  // TCP options can't be set on a unix socket
+  int fds[2];
+  REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+  int next_fd = dup(0);
+  close(next_fd);
+
+  Actor self;
+  Channel<std::vector<uint8_t>> on_message(self);
+  Channel<CloseReason> on_close(self);
+  REQUIRE_THROWS_AS(
+      RecvThread(fds[0], on_message, on_close, SocketOptions::low_latency()),
+      std::runtime_error);
+
+  int fd = dup(0);
+  REQUIRE(fd == next_fd);
+  close(fd);
+  close(fds[0]);
+  close(fds[1]);
+}
+
+TEST_CASE("buffer send and receive") {
+  int listen_fd = listen("localhost", 0);
+  int client_fd = connect("localhost", local_port(listen_fd));
+  int server_fd = accept(listen_fd);
+
+  {
+    Actor self;
+    Channel<Buffer> on_message(self);
+    Channel<CloseReason> on_close(self);
+
+    ActorThread<BufferRecvThread> recv(server_fd, on_message, on_close);
+
+    BufferChain chain;
+    chain.append(Buffer("hello ", 6));
+    chain.append(Buffer("world", 5));
+    send_all(client_fd, chain);
+    close(client_fd);
+
+    BufferChain received;
+    while (self.wait(on_message, on_close) == 0)
+      received.append(on_message.pop());
+    REQUIRE(on_close.pop() == CloseReason::Normal);
+
+    Buffer flat = received.flatten();
+    REQUIRE(std::string((const char *)flat.data(), flat.size()) ==
+            "hello world");
+  }
+
+  close(server_fd);
+  close(listen_fd);
+}
+
+TEST_CASE("byte budget") {
+  int listen_fd = listen("localhost", 0);
+  int client_fd = connect("localhost", local_port(listen_fd));
+  int server_fd = accept(listen_fd);
+
+  const size_t total = 10000;
+  std::vector<uint8_t> data(total, 'x');
+  REQUIRE(send(client_fd, data.data(), data.size(), MSG_NOSIGNAL) == total);
+
+  {
+    Actor self;
+    Channel<std::vector<uint8_t>> on_message(self);
+    Channel<CloseReason> on_close(self);
+    ByteBudget budget(1000, 500);
+
+    ActorThread<RecvThread> recv(server_fd, on_message, on_close, budget);
+
+    // reading stops once the high watermark is reached; at most one read
+    // goes over it
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    REQUIRE(budget.outstanding() >= 1000);
+    REQUIRE(budget.outstanding() < 1000 + 128);
+
+    size_t received = 0;
+    while (received < total) {
+      REQUIRE(self.wait(on_message, on_close) == 0);
+      std::vector<uint8_t> buf = on_message.pop();
+      received += buf.size();
+      budget.consumed(buf.size());
+    }
+    REQUIRE(received == total);
+
+    // exit while paused
+    REQUIRE(send(client_fd, data.data(), data.size(), MSG_NOSIGNAL) == total);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    REQUIRE(budget.outstanding() >= 1000);
+  }
+
+  close(client_fd);
+  close(server_fd);
+  close(listen_fd);
+}
+
+TEST_CASE("exit while paused before reading") {
+  int listen_fd = listen("localhost", 0);
+  int client_fd = connect("localhost", local_port(listen_fd));
+  int server_fd = accept(listen_fd);
+
+  {
+    Actor self;
+    Channel<std::vector<uint8_t>> on_message(self);
+    Channel<CloseReason> on_close(self);
+    ByteBudget budget(1000, 500);
+    budget.produced(1000);
+
+    ActorThread<RecvThread> recv(server_fd, on_message, on_close, budget);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  close(client_fd);
+  close(server_fd);
+  close(listen_fd);
+}
@@ -0,0 +1,138 @@
+#include "actorpp/actor.hpp"
+#include "actorpp/net.hpp"
+#include "actorpp/pool.hpp"
+#include "catch2/catch.hpp"
+#include <thread>
+
+using namespace actorpp;
+using namespace std::chrono_literals;
+
+TEST_CASE("pool reuses connections") {
+  int listen_fd = listen("localhost", 0);
+  int port = local_port(listen_fd);
+
+  Actor self;
+  Channel<PooledConnection> reply(self);
+  ActorThread<ConnectionPool> pool;
+
+  pool.requests.push(ConnectionRequest{"localhost", port, reply});
+  PooledConnection conn = reply.read();
+  REQUIRE(conn.fd >= 0);
+  int client_port = local_port(conn.fd);
+  pool.release.push(conn);
+
+  pool.requests.push(ConnectionRequest{"localhost", port, reply});
+  PooledConnection conn2 = reply.read();
+  REQUIRE(conn2.fd == conn.fd);
+  REQUIRE(local_port(conn2.fd) == client_port);
+  pool.release.push(conn2);
+
+  close(listen_fd);
+}
+
+TEST_CASE("pool limits connections per destination") {
+  int listen_fd = listen("localhost", 0);
+  int port = local_port(listen_fd);
+
+  Actor self;
+  Channel<PooledConnection> reply(self);
+  ActorThread<ConnectionPool> pool(1);
+
+  pool.requests.push(ConnectionRequest{"localhost", port, reply});
+  PooledConnection conn = reply.read();
+  REQUIRE(conn.fd >= 0);
+
+  pool.requests.push(ConnectionRequest{"localhost", port, reply});
+  REQUIRE(self.wait_for(100ms, reply) == -1);
+
+  pool.release.push(conn);
+  PooledConnection conn2 = reply.read();
+  REQUIRE(conn2.fd == conn.fd);
+  pool.release.push(conn2);
+
+  close(listen_fd);
+}
+
+TEST_CASE("pool ignores repeated and unknown releases") {
+  int listen_fd = listen("localhost", 0);
+  int port = local_port(listen_fd);
+  int sync_listen_fd = listen("localhost", 0);
+  int sync_port = local_port(sync_listen_fd);
+
+  Actor self;
+  Channel<PooledConnection> reply(self);
+  ActorThread<ConnectionPool> pool(1);
+
+  pool.requests.push(ConnectionRequest{"localhost", sync_port, reply});
+  PooledConnection sync = reply.read();
+  REQUIRE(sync.fd >= 0);
+
+  pool.requests.push(ConnectionRequest{"localhost", port, reply});
+  PooledConnection conn = reply.read();
+  REQUIRE(conn.fd >= 0);
+  pool.release.push(conn);
+  pool.release.push(conn);
+  pool.release.push(PooledConnection{"localhost", port + 1, conn.fd, true});
+
+  // releases are handled in order, so once sync has been handed out again
+  // the releases above have been handled
+  pool.release.push(sync);
+  pool.requests.push(ConnectionRequest{"localhost", sync_port, reply});
+  PooledConnection sync2 = reply.read();
+  REQUIRE(sync2.fd == sync.fd);
+  pool.release.push(sync2);
+
+  // the connection is only handed out once, and the limit still applies
+  pool.requests.push(ConnectionRequest{"localhost", port, reply});
+  PooledConnection conn2 = reply.read();
+  REQUIRE(conn2.fd == conn.fd);
+  pool.requests.push(ConnectionRequest{"localhost", port, reply});
+  REQUIRE(self.wait_for(100ms, reply) == -1);
+
+  pool.release.push(conn2);
+  PooledConnection conn3 = reply.read();
+  REQUIRE(conn3.fd == conn.fd);
+  pool.release.push(conn3);
+
+  close(listen_fd);
+  close(sync_listen_fd);
+}
+
+TEST_CASE("pool replaces closed connections") {
+  int listen_fd = listen("localhost", 0);
+  int port = local_port(listen_fd);
+
+  Actor self;
+  Channel<PooledConnection> reply(self);
+  ActorThread<ConnectionPool> pool;
+
+  pool.requests.push(ConnectionRequest{"localhost", port, reply});
+  PooledConnection conn = reply.read();
+  REQUIRE(conn.fd >= 0);
+  int client_port = local_port(conn.fd);
+
+  close(accept(listen_fd));
+  std::this_thread::sleep_for(10ms);
+  pool.release.push(conn);
+
+  pool.requests.push(ConnectionRequest{"localhost", port, reply});
+  PooledConnection conn2 = reply.read();
+  REQUIRE(conn2.fd >= 0);
+  REQUIRE(local_port(conn2.fd) != client_port);
+  pool.release.push(conn2);
+
+  close(listen_fd);
+}
+
+TEST_CASE("pool reports connection failures") {
+  int listen_fd = listen("localhost", 0);
+  int port = local_port(listen_fd);
+  close(listen_fd);
+
+  Actor self;
+  Channel<PooledConnection> reply(self);
+  ActorThread<ConnectionPool> pool;
+
+  pool.requests.push(ConnectionRequest{"localhost", port, reply});
+  REQUIRE(reply.read().fd == -1);
+}
@@ -0,0 +1,445 @@
+#include "actorpp/actor.hpp"
+#include "actorpp/framing.hpp"
+#include "actorpp/net.hpp"
+#include "actorpp/remote.hpp"
+#include "catch2/catch.hpp"
+#include <thread>
+
+using namespace actorpp;
+
+struct Point {
+  int32_t x, y;
+};
+
+namespace actorpp {
+template <> struct Serializer<Point> {
+  static void write(const Point &value, std::vector<uint8_t> &out) {
+    uint8_t data[8];
+    detail::write_be32(data, value.x);
+    detail::write_be32(data + 4, value.y);
+    out.insert(out.end(), data, data + 8);
+  }
+  static bool read(const Buffer &data, Point &value) {
+    if (data.size() != 8)
+      return false;
+    value.x = detail::read_be32(data.data());
+    value.y = detail::read_be32(data.data() + 4);
+    return true;
+  }
+};
+
+// vectors of Points are copied as they are in memory
+template <> struct MemcpySerializable<Point> : std::true_type {};
+} // namespace actorpp
+
+static void socket_pair(int &client_fd, int &server_fd) {
+  int listen_fd = listen("localhost", 0);
+  client_fd = connect("localhost", local_port(listen_fd));
+  server_fd = accept(listen_fd);
+  close(listen_fd);
+}
+
+TEST_CASE("frames") {
+  int client_fd, server_fd;
+  socket_pair(client_fd, server_fd);
+
+  {
+    Actor self;
+    Channel<Buffer> on_frame(self);
+    Channel<CloseReason> on_close(self);
+
+    ActorThread<FrameRecvThread> recv(server_fd, on_frame, on_close);
+    ActorThread<FrameSendThread> sender(client_fd, on_close);
+
+    // empty, small, and larger than a read block
+    std::vector<size_t> sizes = {0, 1, 100, 200000, 5};
+    for (size_t size : sizes) {
+      std::vector<uint8_t> data(size);
+      for (size_t i = 0; i < size; i++)
+        data[i] = i * 7;
+      sender.frames.push(BufferChain(Buffer(std::move(data))));
+    }
+
+    for (size_t size : sizes) {
+      REQUIRE(self.wait(on_frame, on_close) == 0);
+      Buffer frame = on_frame.pop();
+      REQUIRE(frame.size() == size);
+      for (size_t i = 0; i < size; i++)
+        REQUIRE(frame[i] == uint8_t(i * 7));
+    }
+
+    shutdown(client_fd, SHUT_WR);
+    REQUIRE(self.wait(on_frame, on_close) == 1);
+    REQUIRE(on_close.pop() == CloseReason::Normal);
+  }
+
+  close(client_fd);
+  close(server_fd);
+}
+
+TEST_CASE("frames queued at exit are sent") {
+  int client_fd, server_fd;
+  socket_pair(client_fd, server_fd);
+
+  {
+    Actor self;
+    Channel<Buffer> on_frame(self);
+    Channel<CloseReason> on_close(self);
+
+    ActorThread<FrameRecvThread> recv(server_fd, on_frame, on_close);
+
+    const size_t n = 1000;
+    {
+      ActorThread<FrameSendThread> sender(client_fd, on_close, 64);
+      for (size_t i = 0; i < n; i++)
+        sender.frames.push(BufferChain(Buffer(std::vector<uint8_t>(16, i))));
+    }
+
+    for (size_t i = 0; i < n; i++) {
+      REQUIRE(self.wait(on_frame, on_close) == 0);
+      REQUIRE(on_frame.pop() == Buffer(std::vector<uint8_t>(16, i)));
+    }
+  }
+
+  close(client_fd);
+  close(server_fd);
+}
+
+TEST_CASE("truncated frame") {
+  int client_fd, server_fd;
+  socket_pair(client_fd, server_fd);
+
+  {
+    Actor self;
+    Channel<Buffer> on_frame(self);
+    Channel<CloseReason> on_close(self);
+
+    ActorThread<FrameRecvThread> recv(server_fd, on_frame, on_close);
+
+    // header for 10 bytes, followed by only 3
+    uint8_t data[] = {0, 0, 0, 10, 1, 2, 3};
+    REQUIRE(send(client_fd, data, sizeof(data), MSG_NOSIGNAL) == 7);
+    shutdown(client_fd, SHUT_WR);
+
+    REQUIRE(self.wait(on_frame, on_close) == 1);
+    REQUIRE(on_close.pop() == CloseReason::Error);
+  }
+
+  close(client_fd);
+  close(server_fd);
+}
+
+TEST_CASE("checksummed frames") {
+  int client_fd, server_fd;
+  socket_pair(client_fd, server_fd);
+
+  {
+    Actor self;
+    Channel<Buffer> on_frame(self);
+    Channel<CloseReason> on_close(self);
+
+    ActorThread<FrameRecvThread> recv(server_fd, on_frame, on_close,
+                                      1024 * 1024, FrameChecksum::CRC32C);
+    ActorThread<FrameSendThread> sender(client_fd, on_close, 256 * 1024,
+                                        FrameChecksum::CRC32C);
+
+    sender.frames.push(BufferChain(Buffer("hello", 5)));
+    REQUIRE(self.wait(on_frame, on_close) == 0);
+    REQUIRE(on_frame.pop() == Buffer("hello", 5));
+
+    // a frame with a correct checksum, then one with a flipped bit
+    uint8_t data[] = {0, 0, 0, 1, 'a', 0, 0, 0, 0};
+    detail::write_be32(data + 5, crc32c(data, 5));
+    REQUIRE(send(client_fd, data, sizeof(data), MSG_NOSIGNAL) == 9);
+    data[4] ^= 1;
+    REQUIRE(send(client_fd, data, sizeof(data), MSG_NOSIGNAL) == 9);
+
+    REQUIRE(self.wait(on_frame, on_close) == 0);
+    REQUIRE(on_frame.pop() == Buffer("a", 1));
+    REQUIRE(self.wait(on_frame, on_close) == 1);
+    REQUIRE(on_close.pop() == CloseReason::Error);
+  }
+
+  close(client_fd);
+  close(server_fd);
+}
+
+TEST_CASE("remote channels") {
+  int client_fd, server_fd;
+  socket_pair(client_fd, server_fd);
+
+  {
+    Actor self;
+    Channel<std::string> strings(self);
+    Channel<Point> points(self);
+    Channel<CloseReason> on_close(self);
+
+    RemoteChannels channels;
+    channels.add(1, strings);
+    channels.add(2, points);
+    REQUIRE_THROWS_AS(channels.add(2, strings), std::logic_error);
+
+    ActorThread<RemoteRecvThread> recv(server_fd, channels, on_close);
+    ActorThread<FrameSendThread> sender(client_fd, on_close);
+
+    RemoteChannel<std::string> remote_strings(sender.frames, 1);
+    RemoteChannel<Point> remote_points(sender.frames, 2);
+
+    const int n = 1000;
+    for (int i = 0; i < n; i++) {
+      remote_strings.push(std::to_string(i));
+      remote_points.push(Point{i, -i});
+    }
+
+    for (int i = 0; i < n; i++) {
+      while (!strings.readable())
+        REQUIRE(self.wait(strings, on_close) == 0);
+      REQUIRE(strings.pop() == std::to_string(i));
+
+      while (!points.readable())
+        REQUIRE(self.wait(points, on_close) == 0);
+      Point point = points.pop();
+      REQUIRE(point.x == i);
+      REQUIRE(point.y == -i);
+    }
+
+    shutdown(client_fd, SHUT_WR);
+    REQUIRE(self.wait(on_close) == 0);
+    REQUIRE(on_close.pop() == CloseReason::Normal);
+  }
+
+  close(client_fd);
+  close(server_fd);
+}
+
+TEST_CASE("remote unknown channel") {
+  int client_fd, server_fd;
+  socket_pair(client_fd, server_fd);
+
+  {
+    Actor self;
+    Channel<std::string> strings(self);
+    Channel<CloseReason> on_close(self);
+
+    RemoteChannels channels;
+    channels.add(1, strings);
+
+    ActorThread<RemoteRecvThread> recv(server_fd, channels, on_close);
+    ActorThread<FrameSendThread> sender(client_fd, on_close);
+
+    RemoteChannel<std::string>(sender.frames, 1).push("known");
+    RemoteChannel<std::string>(sender.frames, 3).push("unknown");
+
+    REQUIRE(self.wait(strings, on_close) == 0);
+    REQUIRE(strings.pop() == "known");
+    REQUIRE(self.wait(strings, on_close) == 1);
+    REQUIRE(on_close.pop() == CloseReason::Error);
+  }
+
+  close(client_fd);
+  close(server_fd);
+}
+
+TEST_CASE("remote credit") {
+  int client_fd, server_fd;
+  socket_pair(client_fd, server_fd);
+
+  {
+    // receiving end, which sends credit back over the same socket
+    Actor self;
+    Channel<std::string> strings(self);
+    Channel<CloseReason> on_close(self);
+
+    ActorThread<FrameSendThread> credit_sender(server_fd, on_close);
+    CreditWindow window(credit_sender.frames, 1, 4, 1024);
+    RemoteChannels channels;
+    channels.add(strings, window);
+    ActorThread<RemoteRecvThread> recv(server_fd, channels, on_close);
+
+    // sending end
+    Channel<CloseReason> sender_close;
+    RemoteCredits credits;
+    RemoteCredit credit = credits.add(1);
+    ActorThread<CreditRecvThread> credit_recv(client_fd, credits, sender_close);
+    ActorThread<FrameSendThread> sender(client_fd, sender_close);
+    RemoteChannel<std::string> remote(sender.frames, 1, credit);
+
+    // blocks until the initial credit arrives
+    for (int i = 0; i < 4; i++)
+      remote.push(std::to_string(i));
+    REQUIRE(!remote.try_push("4"));
+
+    for (int i = 0; i < 4; i++) {
+      while (!strings.readable())
+        REQUIRE(self.wait(strings, on_close) == 0);
+      REQUIRE(strings.pop() == std::to_string(i));
+      window.consumed();
+
+      // credit is returned in batches of half the window
+      if (i == 0)
+        REQUIRE(!remote.try_push("4"));
+    }
+
+    for (int i = 4; i < 8; i++)
+      remote.push(std::to_string(i));
+    for (int i = 4; i < 8; i++) {
+      while (!strings.readable())
+        REQUIRE(self.wait(strings, on_close) == 0);
+      REQUIRE(strings.pop() == std::to_string(i));
+    }
+
+    // closing the connection wakes blocked senders; Catch assertions can
+    // only be made on the main thread
+    bool threw = false;
+    std::thread blocked([&] {
+      try {
+        remote.push("blocked");
+      } catch (const std::runtime_error &) {
+        threw = true;
+      }
+    });
+    shutdown(server_fd, SHUT_WR);
+    blocked.join();
+    REQUIRE(threw);
+  }
+
+  close(client_fd);
+  close(server_fd);
+}
+
+TEST_CASE("remote credit overrun") {
+  int client_fd, server_fd;
+  socket_pair(client_fd, server_fd);
+
+  {
+    Actor self;
+    Channel<std::string> strings(self);
+    Channel<CloseReason> on_close(self);
+
+    ActorThread<FrameSendThread> credit_sender(server_fd, on_close);
+    CreditWindow window(credit_sender.frames, 1, 1, 1024);
+    RemoteChannels channels;
+    channels.add(strings, window);
+    ActorThread<RemoteRecvThread> recv(server_fd, channels, on_close);
+
+    // ignores credit
+    ActorThread<FrameSendThread> sender(client_fd, on_close);
+    RemoteChannel<std::string> remote(sender.frames, 1);
+    remote.push("a");
+    remote.push("b");
+
+    REQUIRE(self.wait(strings, on_close) == 0);
+    REQUIRE(strings.pop() == "a");
+    REQUIRE(self.wait(strings, on_close) == 1);
+    REQUIRE(on_close.pop() == CloseReason::Error);
+  }
+
+  close(client_fd);
+  close(server_fd);
+}
+
+TEST_CASE("remote credit in both directions") {
+  int a_fd, b_fd;
+  socket_pair(a_fd, b_fd);
+
+  {
+    Actor self;
+    Channel<std::string> a_strings(self);
+    Channel<std::string> b_strings(self);
+    Channel<CloseReason> on_close(self);
+
+    // each end sends values and credit over the same socket, and one
+    // RemoteRecvThread receives both
+    ActorThread<FrameSendThread> a_sender(a_fd, on_close);
+    RemoteCredits a_credits;
+    RemoteChannel<std::string> a_to_b(a_sender.frames, 2, a_credits.add(2));
+    CreditWindow a_window(a_sender.frames, 1, 2, 1024);
+    RemoteChannels a_channels;
+    a_channels.add(a_strings, a_window);
+    a_channels.add_credits(a_credits);
+    REQUIRE_THROWS_AS(a_channels.add(remote_credit_channel_id, a_strings),
+                      std::logic_error);
+
+    ActorThread<FrameSendThread> b_sender(b_fd, on_close);
+    RemoteCredits b_credits;
+    RemoteChannel<std::string> b_to_a(b_sender.frames, 1, b_credits.add(1));
+    CreditWindow b_window(b_sender.frames, 2, 2, 1024);
+    RemoteChannels b_channels;
+    b_channels.add(b_strings, b_window);
+    b_channels.add_credits(b_credits);
+
+    ActorThread<RemoteRecvThread> a_recv(a_fd, a_channels, on_close);
+    ActorThread<RemoteRecvThread> b_recv(b_fd, b_channels, on_close);
+
+    for (int round = 0; round < 2; round++) {
+      for (int i = 0; i < 2; i++) {
+        a_to_b.push("a" + std::to_string(i));
+        b_to_a.push("b" + std::to_string(i));
+      }
+      REQUIRE(!a_to_b.try_push("x"));
+      REQUIRE(!b_to_a.try_push("x"));
+
+      for (int i = 0; i < 2; i++) {
+        while (!b_strings.readable())
+          REQUIRE(self.wait(b_strings, on_close) == 0);
+        REQUIRE(b_strings.pop() == "a" + std::to_string(i));
+        b_window.consumed();
+
+        while (!a_strings.readable())
+          REQUIRE(self.wait(a_strings, on_close) == 0);
+        REQUIRE(a_strings.pop() == "b" + std::to_string(i));
+        a_window.consumed();
+      }
+    }
+
+    // wait for the last credit to be sent, as sending it would fail after
+    // the shutdown below
+    a_to_b.push("a");
+    b_to_a.push("b");
+    REQUIRE(b_strings.read() == "a");
+    REQUIRE(a_strings.read() == "b");
+
+    // closing the connection closes the credits at the other end
+    shutdown(a_fd, SHUT_WR);
+    REQUIRE(self.wait(on_close) == 0);
+    REQUIRE(on_close.pop() == CloseReason::Normal);
+    REQUIRE_THROWS_AS(b_to_a.try_push("x"), std::runtime_error);
+  }
+
+  close(a_fd);
+  close(b_fd);
+}
+
+TEST_CASE("remote batches") {
+  int client_fd, server_fd;
+  socket_pair(client_fd, server_fd);
+
+  {
+    Actor self;
+    Channel<std::vector<Point>> batches(self);
+    Channel<CloseReason> on_close(self);
+
+    RemoteChannels channels;
+    channels.add(1, batches);
+
+    ActorThread<RemoteRecvThread> recv(server_fd, channels, on_close);
+    ActorThread<FrameSendThread> sender(client_fd, on_close);
+
+    // vectors of MemcpySerializable values are sent as one block
+    std::vector<Point> points;
+    for (int i = 0; i < 10000; i++)
+      points.push_back(Point{i, -i});
+    RemoteChannel<std::vector<Point>>(sender.frames, 1).push(points);
+
+    REQUIRE(self.wait(batches, on_close) == 0);
+    std::vector<Point> received = batches.pop();
+    REQUIRE(received.size() == points.size());
+    for (size_t i = 0; i < points.size(); i++) {
+      REQUIRE(received[i].x == points[i].x);
+      REQUIRE(received[i].y == points[i].y);
+    }
+  }
+
+  close(client_fd);
+  close(server_fd);
+}
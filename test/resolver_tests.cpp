@@ -0,0 +1,61 @@
+#include "actorpp/actor.hpp"
+#include "actorpp/resolver.hpp"
+#include "catch2/catch.hpp"
+
+using namespace actorpp;
+using namespace std::chrono_literals;
+
+TEST_CASE("resolve localhost") {
+  Actor self;
+  Channel<ResolveResult> reply(self);
+  ActorThread<Resolver> resolver;
+
+  resolver.requests.push(ResolveRequest{"localhost", 5001, reply});
+  ResolveResult result = reply.read();
+
+  REQUIRE(result.hostname == "localhost");
+  REQUIRE(result.port == 5001);
+  REQUIRE(result.error == 0);
+  REQUIRE(!result.addresses.empty());
+  REQUIRE(result.addresses[0].family == AF_INET);
+}
+
+TEST_CASE("resolve coalesces and caches") {
+  Actor self;
+  Channel<ResolveResult> reply(self);
+  ActorThread<Resolver> resolver;
+
+  resolver.requests.push(ResolveRequest{"localhost", 5001, reply});
+  resolver.requests.push(ResolveRequest{"localhost", 5001, reply});
+  REQUIRE(reply.read().error == 0);
+  REQUIRE(reply.read().error == 0);
+
+  resolver.requests.push(ResolveRequest{"localhost", 5001, reply});
+  REQUIRE(reply.read().error == 0);
+
+  REQUIRE(resolver.lookup_count() == 1);
+}
+
+TEST_CASE("resolve ttl expiry") {
+  Actor self;
+  Channel<ResolveResult> reply(self);
+  ActorThread<Resolver> resolver(0s);
+
+  resolver.requests.push(ResolveRequest{"localhost", 5001, reply});
+  REQUIRE(reply.read().error == 0);
+  resolver.requests.push(ResolveRequest{"localhost", 5001, reply});
+  REQUIRE(reply.read().error == 0);
+
+  REQUIRE(resolver.lookup_count() == 2);
+}
+
+TEST_CASE("resolve failure") {
+  Actor self;
+  Channel<ResolveResult> reply(self);
+  ActorThread<Resolver> resolver;
+
+  resolver.requests.push(ResolveRequest{"", 5001, reply});
+  ResolveResult result = reply.read();
+  REQUIRE(result.error != 0);
+  REQUIRE(result.addresses.empty());
+}
@@ -0,0 +1,122 @@
+#include "actorpp/serialize.hpp"
+#include "catch2/catch.hpp"
+
+using namespace actorpp;
+
+struct Sample {
+  uint64_t time;
+  double value;
+  int16_t channel;
+  int16_t reserved[3];
+};
+
+// has tail padding, so must not be copied
+struct Padded {
+  uint64_t time;
+  int16_t channel;
+};
+
+namespace actorpp {
+template <> struct MemcpySerializable<Sample> : std::true_type {};
+} // namespace actorpp
+
+enum class Colour : uint16_t { Red = 0x0102 };
+
+template <typename T> static std::vector<uint8_t> encode(const T &value) {
+  std::vector<uint8_t> out;
+  Serializer<T>::write(value, out);
+  return out;
+}
+
+template <typename T> static T decode(const std::vector<uint8_t> &data) {
+  T value{};
+  REQUIRE(Serializer<T>::read(Buffer(data), value));
+  return value;
+}
+
+TEST_CASE("serialize scalars") {
+  REQUIRE(encode<uint32_t>(0x01020304) ==
+          std::vector<uint8_t>{0x04, 0x03, 0x02, 0x01});
+  REQUIRE(encode(Colour::Red) == std::vector<uint8_t>{0x02, 0x01});
+
+  REQUIRE(decode<uint32_t>({0x04, 0x03, 0x02, 0x01}) == 0x01020304);
+  REQUIRE(decode<double>(encode(1.5)) == 1.5);
+
+  uint32_t value = 0;
+  REQUIRE(!Serializer<uint32_t>::read(Buffer(std::vector<uint8_t>(3)), value));
+}
+
+TEST_CASE("serialize trivially copyable") {
+  Sample sample{1234, 0.5, -3, {}};
+  std::vector<uint8_t> data = encode(sample);
+  REQUIRE(data.size() == sizeof(Sample));
+
+  Sample decoded = decode<Sample>(data);
+  REQUIRE(decoded.time == 1234);
+  REQUIRE(decoded.value == 0.5);
+  REQUIRE(decoded.channel == -3);
+}
+
+TEST_CASE("serialize vectors") {
+  std::vector<Sample> samples;
+  for (int i = 0; i < 100; i++)
+    samples.push_back(Sample{uint64_t(i), i * 0.25, int16_t(-i), {}});
+
+  std::vector<uint8_t> data = encode(samples);
+  REQUIRE(data.size() == 100 * sizeof(Sample));
+
+  std::vector<Sample> decoded = decode<std::vector<Sample>>(data);
+  REQUIRE(decoded.size() == 100);
+  for (int i = 0; i < 100; i++) {
+    REQUIRE(decoded[i].time == uint64_t(i));
+    REQUIRE(decoded[i].value == i * 0.25);
+    REQUIRE(decoded[i].channel == -i);
+  }
+
+  REQUIRE(decode<std::vector<Sample>>({}).empty());
+
+  std::vector<Sample> value;
+  REQUIRE(!Serializer<std::vector<Sample>>::read(
+      Buffer(std::vector<uint8_t>(sizeof(Sample) + 1)), value));
+
+  REQUIRE(decode<std::string>(encode(std::string("hello"))) == "hello");
+}
+
+template <typename T> static void check_byte_swap() {
+  for (size_t n = 0; n < 40; n++) {
+    std::vector<T> values(n);
+    for (size_t i = 0; i < n; i++)
+      for (size_t j = 0; j < sizeof(T); j++)
+        ((uint8_t *)&values[i])[j] = i * sizeof(T) + j;
+
+    ByteSwap<T>::swap(values.data(), n);
+
+    for (size_t i = 0; i < n; i++)
+      for (size_t j = 0; j < sizeof(T); j++)
+        REQUIRE(((uint8_t *)&values[i])[j] ==
+                uint8_t(i * sizeof(T) + sizeof(T) - 1 - j));
+  }
+}
+
+// pointers are not copied as addresses
+static_assert(!detail::is_memcpy_serializable<int *>::value, "");
+static_assert(!detail::is_memcpy_serializable<const char *>::value, "");
+static_assert(!detail::is_memcpy_serializable<int Sample::*>::value, "");
+static_assert(detail::is_memcpy_serializable<Sample>::value, "");
+// structs with padding must opt in, and can't without removing it
+static_assert(!detail::is_memcpy_serializable<Padded>::value, "");
+
+#ifdef __cpp_lib_has_unique_object_representations
+// structs without padding or floating-point members are detected
+struct Point {
+  int32_t x, y;
+};
+static_assert(detail::is_memcpy_serializable<Point>::value, "");
+#endif
+
+TEST_CASE("byte swap") {
+  check_byte_swap<uint8_t>();
+  check_byte_swap<int16_t>();
+  check_byte_swap<uint32_t>();
+  check_byte_swap<double>();
+}
@@ -0,0 +1,156 @@
+#include "actorpp/actor.hpp"
+#include "actorpp/shm.hpp"
+#include "catch2/catch.hpp"
+#include <algorithm>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <thread>
+
+using namespace actorpp;
+
+TEST_CASE("shm channel push pop") {
+  ShmChannel<int> chan = ShmChannel<int>::create(3);
+  REQUIRE(chan.capacity() == 4);
+  REQUIRE(!chan.readable());
+
+  for (int i = 0; i < 4; i++)
+    REQUIRE(chan.try_push(i));
+  REQUIRE(!chan.try_push(4));
+
+  int item;
+  for (int i = 0; i < 4; i++) {
+    REQUIRE(chan.try_pop(item));
+    REQUIRE(item == i);
+  }
+  REQUIRE(!chan.try_pop(item));
+}
+
+TEST_CASE("shm channel attach") {
+  ShmChannel<int> chan = ShmChannel<int>::create(16);
+  ShmChannel<int> other = ShmChannel<int>::attach(chan.fd());
+
+  other.push(5);
+  REQUIRE(chan.read() == 5);
+
+  REQUIRE_THROWS(ShmChannel<char>::attach(chan.fd()));
+
+  // a valid header, but not enough space for the elements
+  int fd = memfd_create("actorpp_test", MFD_CLOEXEC);
+  REQUIRE(fd >= 0);
+  char header[64];
+  REQUIRE(pread(chan.fd(), header, sizeof(header), 0) == sizeof(header));
+  REQUIRE(write(fd, header, sizeof(header)) == sizeof(header));
+  REQUIRE_THROWS_AS(ShmChannel<int>::attach(fd), std::runtime_error);
+  close(fd);
+}
+
+TEST_CASE("shm channel between processes") {
+  const int n = 10000;
+  ShmChannel<int> chan = ShmChannel<int>::create(16);
+
+  pid_t pid = fork();
+  REQUIRE(pid >= 0);
+  if (pid == 0) {
+    ShmChannel<int> child_chan = ShmChannel<int>::attach(chan.fd());
+    for (int i = 0; i < n; i++)
+      child_chan.push(i);
+    _exit(0);
+  }
+
+  {
+    Actor self;
+    Channel<int> on_message(self);
+    ActorThread<ShmRecvThread<int>> recv(chan, on_message);
+
+    for (int i = 0; i < n; i++) {
+      REQUIRE(self.wait(on_message) == 0);
+      REQUIRE(on_message.pop() == i);
+    }
+  }
+
+  int status;
+  REQUIRE(waitpid(pid, &status, 0) == pid);
+  REQUIRE(WIFEXITED(status));
+  REQUIRE(WEXITSTATUS(status) == 0);
+}
+
+TEST_CASE("shm channel writer killed while pushing") {
+  ShmChannel<int> chan = ShmChannel<int>::create(1);
+  REQUIRE(chan.try_push(1));
+
+  // the child blocks in push, as the channel is full
+  pid_t pid = fork();
+  REQUIRE(pid >= 0);
+  if (pid == 0) {
+    chan.push(2);
+    _exit(0);
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // a blocked writer doesn't hold the write lock, so doesn't block others
+  REQUIRE(!chan.try_push(3));
+
+  REQUIRE(kill(pid, SIGKILL) == 0);
+  int status;
+  REQUIRE(waitpid(pid, &status, 0) == pid);
+  REQUIRE(WIFSIGNALED(status));
+
+  REQUIRE(!chan.try_push(3));
+  int item;
+  REQUIRE(chan.try_pop(item));
+  REQUIRE(item == 1);
+  REQUIRE(chan.try_push(3));
+  REQUIRE(chan.try_pop(item));
+  REQUIRE(item == 3);
+}
+
+TEST_CASE("shm channel blocked writers") {
+  ShmChannel<int> chan = ShmChannel<int>::create(1);
+  REQUIRE(chan.try_push(1));
+
+  std::thread a([&] { chan.push(2); });
+  std::thread b([&] { chan.push(3); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  REQUIRE(!chan.try_push(4));
+
+  std::vector<int> items;
+  for (int i = 0; i < 3; i++)
+    items.push_back(chan.read());
+  a.join();
+  b.join();
+
+  REQUIRE(items[0] == 1);
+  std::sort(items.begin(), items.end());
+  REQUIRE(items == std::vector<int>{1, 2, 3});
+  REQUIRE(!chan.readable());
+}
+
+TEST_CASE("shm robust mutex owner killed") {
+  void *addr = mmap(NULL, sizeof(pthread_mutex_t), PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  REQUIRE(addr != MAP_FAILED);
+  pthread_mutex_t &mut = *static_cast<pthread_mutex_t *>(addr);
+  detail::init_robust_mutex(mut);
+
+  // the child dies while holding the lock
+  pid_t pid = fork();
+  REQUIRE(pid >= 0);
+  if (pid == 0) {
+    detail::robust_lock(mut);
+    _exit(0);
+  }
+  int status;
+  REQUIRE(waitpid(pid, &status, 0) == pid);
+
+  REQUIRE(detail::robust_try_lock(mut));
+  bool locked_elsewhere = true;
+  std::thread([&] { locked_elsewhere = detail::robust_try_lock(mut); }).join();
+  REQUIRE(!locked_elsewhere);
+  detail::robust_unlock(mut);
+  detail::robust_lock(mut);
+  detail::robust_unlock(mut);
+
+  pthread_mutex_destroy(&mut);
+  munmap(addr, sizeof(pthread_mutex_t));
+}
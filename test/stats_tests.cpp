@@ -0,0 +1,109 @@
+#include "actorpp/actor.hpp"
+#include "catch2/catch.hpp"
+#include <string>
+#include <vector>
+
+using namespace actorpp;
+
+static const ChannelStats *find(const std::vector<ChannelStats> &stats,
+                                const std::string &name) {
+  for (const ChannelStats &s : stats)
+    if (s.name == name)
+      return &s;
+  return nullptr;
+}
+
+TEST_CASE("channel counters") {
+  Actor self;
+  Channel<int> ints(self);
+
+  ints.push(1);
+  ints.push(2);
+  ints.emplace(3);
+  ints.pop();
+
+  ChannelStats stats = ints.stats();
+  REQUIRE(stats.pushed == 3);
+  REQUIRE(stats.popped == 1);
+  REQUIRE(stats.depth == 2);
+  REQUIRE(stats.high_water == 3);
+  REQUIRE(stats.bytes_pushed == 0);
+
+  ints.clear();
+  stats = ints.stats();
+  REQUIRE(stats.popped == 3);
+  REQUIRE(stats.depth == 0);
+  REQUIRE(stats.high_water == 3);
+}
+
+TEST_CASE("channel byte counters") {
+  Channel<std::vector<uint32_t>> vectors;
+  vectors.push(std::vector<uint32_t>(10));
+  vectors.read();
+
+  Channel<std::string> strings;
+  strings.push(std::string("hello"));
+
+  REQUIRE(vectors.stats().bytes_pushed == 40);
+  REQUIRE(vectors.stats().bytes_popped == 40);
+  REQUIRE(strings.stats().bytes_pushed == 5);
+  REQUIRE(strings.stats().bytes_popped == 0);
+}
+
+TEST_CASE("channel registry") {
+  Channel<int> a;
+  a.set_name("a");
+  a.push(1);
+
+  {
+    Channel<int> b;
+    b.set_name("b");
+
+    std::vector<ChannelStats> stats = channel_stats();
+    REQUIRE(find(stats, "a"));
+    REQUIRE(find(stats, "a")->depth == 1);
+    REQUIRE(find(stats, "b"));
+    REQUIRE(find(stats, "a")->id < find(stats, "b")->id);
+  }
+
+  std::vector<ChannelStats> stats = channel_stats();
+  REQUIRE(find(stats, "a"));
+  REQUIRE(!find(stats, "b"));
+}
+
+TEST_CASE("histogram buckets") {
+  for (size_t i = 0; i + 1 < Histogram::n_buckets; i++) {
+    REQUIRE(Histogram::bucket(Histogram::bucket_lower(i)) == i);
+    REQUIRE(Histogram::bucket(Histogram::bucket_upper(i)) == i);
+    REQUIRE(Histogram::bucket_upper(i) + 1 == Histogram::bucket_lower(i + 1));
+
+    // at most 1/16 relative error
+    uint64_t lower = Histogram::bucket_lower(i);
+    REQUIRE(Histogram::bucket_upper(i) - lower <= lower / 16);
+  }
+  REQUIRE(Histogram::bucket(uint64_t(-1)) == Histogram::n_buckets - 1);
+}
+
+TEST_CASE("histogram percentiles") {
+  Histogram histogram;
+  REQUIRE(histogram.percentile(50) == 0);
+
+  for (uint64_t i = 1; i <= 1000; i++)
+    histogram.record(i * 1000);
+
+  REQUIRE(histogram.count() == 1000);
+  REQUIRE(histogram.max() == 1000000);
+  REQUIRE(histogram.percentile(50) >= 500000);
+  REQUIRE(histogram.percentile(50) <= 500000 * 17 / 16);
+  REQUIRE(histogram.percentile(99) >= 990000);
+  REQUIRE(histogram.percentile(99) <= 1000000);
+  REQUIRE(histogram.percentile(100) == 1000000);
+  REQUIRE(histogram.percentile(0) >= 1000);
+  REQUIRE(histogram.percentile(0) <= 1000 * 17 / 16);
+
+  Histogram other;
+  other.record(5000000);
+  histogram.merge(other);
+  REQUIRE(histogram.count() == 1001);
+  REQUIRE(histogram.percentile(100) == 5000000);
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "actorpp/actor.hpp"
+#include "actorpp/net.hpp"
+#include <string.h>
+
+/// Server for the net tests, listening on a free local port. Connections are
+/// handled one at a time: each 4 byte message "ping" is answered with "pong",
+/// and "exit" closes the connection.
+class TestServer : public actorpp::Actor {
+public:
+  TestServer() : listen_fd(actorpp::listen("localhost", 0)) {}
+  ~TestServer() { close(listen_fd); }
+
+  int port() const { return actorpp::local_port(listen_fd); }
+
+  void run() {
+    while (true) {
+      int fd = ::accept(listen_fd, NULL, NULL);
+      if (fd < 0)
+        return;
+
+      char buf[4];
+      while (recv(fd, buf, 4, MSG_WAITALL) == 4 && memcmp(buf, "ping", 4) == 0)
+        send(fd, "pong", 4, MSG_NOSIGNAL);
+      close(fd);
+    }
+  }
+
+  // wakes accept
+  void exit() { shutdown(listen_fd, SHUT_RDWR); }
+
+private:
+  int listen_fd;
+};
@@ -0,0 +1,99 @@
+#include "actorpp/actor.hpp"
+#include "actorpp/trace.hpp"
+#include "catch2/catch.hpp"
+#include <sstream>
+
+using namespace actorpp;
+
+static size_t count(const std::string &s, const std::string &sub) {
+  size_t n = 0;
+  for (size_t pos = s.find(sub); pos != std::string::npos;
+       pos = s.find(sub, pos + 1))
+    n++;
+  return n;
+}
+
+static std::string trace() {
+  std::ostringstream out;
+  write_trace(out);
+  return out.str();
+}
+
+/// doubles each number, in a span
+class Doubler : public Actor {
+public:
+  Doubler(Channel<int> out) : in(*this), out(out) {}
+
+  void run() {
+    while (true) {
+      int value = in.read();
+      if (value < 0)
+        return;
+      TraceSpan span("double");
+      out.push(value * 2);
+    }
+  }
+
+  void exit() { in.push(-1); }
+
+  Channel<int> in;
+
+private:
+  Channel<int> out;
+};
+
+TEST_CASE("trace flows") {
+  clear_trace();
+  Actor self;
+  Channel<int> results(self);
+  {
+    ActorThread<Doubler> doubler(results);
+    doubler.in.push(1);
+    self.wait(results);
+    REQUIRE(results.pop() == 2);
+  }
+
+  std::string json = trace();
+  REQUIRE(json.find("\"traceEvents\"") != std::string::npos);
+  REQUIRE(json.find("\"name\": \"Doubler\"") != std::string::npos);
+  REQUIRE(json.find("\"name\": \"double\"") != std::string::npos);
+  REQUIRE(json.find("\"name\": \"wait\"") != std::string::npos);
+
+  // in, results, and the exit message
+  REQUIRE(count(json, "\"flow_out\"") == 3);
+  REQUIRE(count(json, "\"flow_in\"") == 3);
+
+  // the push and pop of each message have the same ID
+  size_t pos = json.find("\"bind_id\": ");
+  std::string bind_id = json.substr(pos, json.find(',', pos) - pos);
+  REQUIRE(count(json, bind_id + ",") == 2);
+}
+
+TEST_CASE("trace buffer wraps") {
+  clear_trace();
+  detail::TraceBuffer &buffer = detail::thread_trace();
+  for (size_t i = 0; i < detail::TraceBuffer::size + 10; i++)
+    TraceSpan span("span");
+
+  std::vector<detail::TraceEvent> events = buffer.events();
+  REQUIRE(events.size() == detail::TraceBuffer::size);
+  for (size_t i = 1; i < events.size(); i++)
+    REQUIRE(events[i].start_ns >= events[i - 1].end_ns);
+}
+
+TEST_CASE("clear trace") {
+  { TraceSpan span("before clear"); }
+  clear_trace();
+  { TraceSpan span("after clear"); }
+
+  std::string json = trace();
+  REQUIRE(json.find("before clear") == std::string::npos);
+  REQUIRE(json.find("after clear") != std::string::npos);
+}
+
+TEST_CASE("json escaping") {
+  clear_trace();
+  { TraceSpan span("a \"quoted\"\n name"); }
+  REQUIRE(trace().find("\"a \\\"quoted\\\"\\u000a name\"") !=
+          std::string::npos);
+}
@@ -0,0 +1,95 @@
+#include "actorpp/actor.hpp"
+#include "actorpp/net.hpp"
+#include "actorpp/udp.hpp"
+#include "catch2/catch.hpp"
+
+using namespace actorpp;
+
+TEST_CASE("udp batches") {
+  int recv_fd = bind_udp("localhost", 0);
+  int send_fd = bind_udp("localhost", 0);
+  Address dest = resolve("localhost", local_port(recv_fd), SOCK_DGRAM)[0];
+
+  const int n = 200;
+  std::vector<Datagram> datagrams;
+  for (int i = 0; i < n; i++) {
+    std::string s = std::to_string(i);
+    datagrams.push_back(Datagram{dest, Buffer(s.data(), s.size())});
+  }
+
+  {
+    Actor self;
+    Channel<std::vector<Datagram>> on_message(self);
+    Channel<CloseReason> on_close(self);
+
+    ActorThread<DatagramRecvThread> recv(recv_fd, on_message, on_close, 16);
+
+    send_datagrams(send_fd, datagrams);
+
+    int received = 0;
+    while (received < n) {
+      REQUIRE(self.wait(on_message, on_close) == 0);
+      std::vector<Datagram> batch = on_message.pop();
+      REQUIRE(batch.size() <= 16);
+      for (const Datagram &datagram : batch) {
+        REQUIRE(datagram.data == datagrams[received].data);
+        REQUIRE(datagram.address.port() == local_port(send_fd));
+        received++;
+      }
+    }
+  }
+
+  close(send_fd);
+  close(recv_fd);
+}
+
+TEST_CASE("udp connected") {
+  int recv_fd = bind_udp("localhost", 0);
+  int send_fd = connect_udp("localhost", local_port(recv_fd));
+
+  {
+    Actor self;
+    Channel<std::vector<Datagram>> on_message(self);
+    Channel<CloseReason> on_close(self);
+
+    ActorThread<DatagramRecvThread> recv(recv_fd, on_message, on_close, 16,
+                                         8);
+
+    send_datagrams(send_fd, {Datagram{Address{}, Buffer("too long!", 9)},
+                             Datagram{Address{}, Buffer("", 0)},
+                             Datagram{Address{}, Buffer("short", 5)}});
+
+    std::vector<Datagram> received;
+    while (received.size() < 2) {
+      REQUIRE(self.wait(on_message, on_close) == 0);
+      for (Datagram &datagram : on_message.pop())
+        received.push_back(datagram);
+    }
+    REQUIRE(received[0].data.empty());
+    REQUIRE(received[1].data == Buffer("short", 5));
+  }
+
+  close(send_fd);
+  close(recv_fd);
+}
+
+TEST_CASE("block pool reuse") {
+  auto pool = std::make_shared<detail::BlockPool>(16, 1);
+  std::shared_ptr<std::vector<uint8_t>> a = pool->get();
+  REQUIRE(a->size() == 16);
+  const std::vector<uint8_t> *a_ptr = a.get();
+
+  // a block is reused once the last Buffer made from it is freed
+  Buffer buffer(a, 0, 16);
+  a.reset();
+  std::shared_ptr<std::vector<uint8_t>> b = pool->get();
+  REQUIRE(b.get() != a_ptr);
+  buffer = Buffer();
+  std::shared_ptr<std::vector<uint8_t>> c = pool->get();
+  REQUIRE(c.get() == a_ptr);
+
+  // blocks may outlive the pool
+  pool.reset();
+  b.reset();
+  c.reset();
+}
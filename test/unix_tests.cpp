@@ -0,0 +1,129 @@
+#include "actorpp/actor.hpp"
+#include "actorpp/net.hpp"
+#include "actorpp/unix.hpp"
+#include "catch2/catch.hpp"
+#include <sys/mman.h>
+
+using namespace actorpp;
+
+static std::string socket_path() {
+  std::string path = "/tmp/actorpp_unix_tests_" + std::to_string(getpid());
+  unlink(path.c_str());
+  return path;
+}
+
+TEST_CASE("unix ping pong") {
+  std::string path = socket_path();
+  int listen_fd = listen_unix(path);
+  int client_fd = connect_unix(path);
+  int server_fd = accept(listen_fd);
+
+  {
+    Actor self;
+    Channel<std::vector<uint8_t>> on_message(self);
+    Channel<CloseReason> on_close(self);
+
+    ActorThread<RecvThread> recv(server_fd, on_message, on_close);
+
+    send(client_fd, "ping", 4, MSG_NOSIGNAL);
+
+    REQUIRE(self.wait(on_message, on_close) == 0);
+    std::vector<uint8_t> buf = on_message.pop();
+    REQUIRE(std::string((char *)buf.data(), buf.size()) == "ping");
+
+    close(client_fd);
+    REQUIRE(self.wait(on_message, on_close) == 1);
+    REQUIRE(on_close.pop() == CloseReason::Normal);
+  }
+
+  close(server_fd);
+  close(listen_fd);
+  unlink(path.c_str());
+}
+
+TEST_CASE("unix fd passing") {
+  std::string path = socket_path();
+  int listen_fd = listen_unix(path, 16, SOCK_SEQPACKET);
+  int client_fd = connect_unix(path, SOCK_SEQPACKET);
+  int server_fd = accept(listen_fd);
+
+  int mem_fd = memfd_create("actorpp_test", 0);
+  REQUIRE(mem_fd >= 0);
+  REQUIRE(write(mem_fd, "hello", 5) == 5);
+
+  {
+    Actor self;
+    Channel<UnixMessage> on_message(self);
+    Channel<CloseReason> on_close(self);
+
+    ActorThread<UnixRecvThread> recv(server_fd, on_message, on_close);
+    ActorThread<UnixSendThread> sender(client_fd, on_close);
+
+    sender.messages.push(UnixMessage{{'m'}, {mem_fd}});
+
+    REQUIRE(self.wait(on_message, on_close) == 0);
+    UnixMessage message = on_message.pop();
+    REQUIRE(message.data == std::vector<uint8_t>{'m'});
+    REQUIRE(message.fds.size() == 1);
+
+    char buf[5];
+    REQUIRE(pread(message.fds[0], buf, 5, 0) == 5);
+    REQUIRE(std::string(buf, 5) == "hello");
+    close(message.fds[0]);
+  }
+
+  close(client_fd);
+  close(server_fd);
+  close(listen_fd);
+  unlink(path.c_str());
+}
+
+TEST_CASE("unix message boundaries") {
+  std::string path = socket_path();
+  int listen_fd = listen_unix(path, 16, SOCK_SEQPACKET);
+  int client_fd = connect_unix(path, SOCK_SEQPACKET);
+  int server_fd = accept(listen_fd);
+
+  {
+    Actor self;
+    Channel<UnixMessage> on_message(self);
+    Channel<CloseReason> on_close(self);
+
+    ActorThread<UnixRecvThread> recv(server_fd, on_message, on_close);
+
+    std::vector<uint8_t> large(unix_message_max_size, 'x');
+    send_message(client_fd, UnixMessage{{'a', 'b'}, {}});
+    send_message(client_fd, UnixMessage{large, {}});
+    send_message(client_fd, UnixMessage{{'c'}, {}});
+
+    REQUIRE(self.wait(on_message, on_close) == 0);
+    REQUIRE(on_message.pop().data == std::vector<uint8_t>{'a', 'b'});
+    REQUIRE(self.wait(on_message, on_close) == 0);
+    REQUIRE(on_message.pop().data == large);
+    REQUIRE(self.wait(on_message, on_close) == 0);
+    REQUIRE(on_message.pop().data == std::vector<uint8_t>{'c'});
+
+    REQUIRE_THROWS_AS(send_message(client_fd, UnixMessage{{}, {}}),
+                      std::logic_error);
+  }
+
+  close(client_fd);
+  close(server_fd);
+  close(listen_fd);
+  unlink(path.c_str());
+}
+
+TEST_CASE("unix messages need a seqpacket socket") {
+  int fds[2];
+  REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+
+  Actor self;
+  Channel<UnixMessage> on_message(self);
+  Channel<CloseReason> on_close(self);
+  REQUIRE_THROWS_AS(UnixRecvThread(fds[0], on_message, on_close),
+                    std::logic_error);
+  REQUIRE_THROWS_AS(UnixSendThread(fds[1], on_close), std::logic_error);
+
+  close(fds[0]);
+  close(fds[1]);
+}
@@ -0,0 +1,74 @@
+#include "actorpp/actor.hpp"
+#include "actorpp/net.hpp"
+#include "catch2/catch.hpp"
+#include <elf.h>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <sys/socket.h>
+
+using namespace actorpp;
+
+/// the names of the USDT probes in the actorpp provider in this executable,
+/// read from the .note.stapsdt section
+static std::set<std::string> probe_names() {
+  std::ifstream file("/proc/self/exe", std::ios::binary);
+  std::string elf((std::istreambuf_iterator<char>(file)),
+                  std::istreambuf_iterator<char>());
+  REQUIRE(elf.size() > sizeof(Elf64_Ehdr));
+
+  const Elf64_Ehdr *header = (const Elf64_Ehdr *)elf.data();
+  const Elf64_Shdr *sections =
+      (const Elf64_Shdr *)(elf.data() + header->e_shoff);
+  const char *section_names =
+      elf.data() + sections[header->e_shstrndx].sh_offset;
+
+  std::set<std::string> names;
+  for (size_t i = 0; i < header->e_shnum; i++) {
+    if (std::string(section_names + sections[i].sh_name) != ".note.stapsdt")
+      continue;
+
+    const char *note = elf.data() + sections[i].sh_offset;
+    const char *end = note + sections[i].sh_size;
+    while (note < end) {
+      const Elf64_Nhdr *nhdr = (const Elf64_Nhdr *)note;
+      const char *desc =
+          note + sizeof(Elf64_Nhdr) + ((nhdr->n_namesz + 3) & ~3);
+      REQUIRE(nhdr->n_type == 3);
+
+      // three addresses, then provider, name and arguments
+      const char *provider = desc + 24;
+      const char *name = provider + strlen(provider) + 1;
+      if (std::string(provider) == "actorpp")
+        names.insert(name);
+
+      note = desc + ((nhdr->n_descsz + 3) & ~3);
+    }
+  }
+  return names;
+}
+
+TEST_CASE("usdt probes") {
+  int fds[2];
+  REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+  {
+    Actor self;
+    Channel<std::vector<uint8_t>> on_message(self);
+    Channel<CloseReason> on_close(self);
+    ActorThread<RecvThread> recv(fds[0], on_message, on_close);
+
+    REQUIRE(send(fds[1], "ping", 4, MSG_NOSIGNAL) == 4);
+    REQUIRE(self.wait(on_message, on_close) == 0);
+    REQUIRE(on_message.pop().size() == 4);
+
+    close(fds[1]);
+    REQUIRE(self.wait(on_message, on_close) == 1);
+    REQUIRE(on_close.pop() == CloseReason::Normal);
+  }
+  close(fds[0]);
+
+  std::set<std::string> names = probe_names();
+  for (const char *name : {"push", "pop", "wait_enter", "wait_exit", "receive",
+                           "recv_close"})
+    REQUIRE(names.count(name) == 1);
+}
@@ -0,0 +1,90 @@
+#include "actorpp/actor.hpp"
+#include "actorpp/watchdog.hpp"
+#include "catch2/catch.hpp"
+#include <thread>
+
+using namespace actorpp;
+using namespace std::chrono_literals;
+
+/// handles each message by sleeping for that many milliseconds
+class Sleeper : public Actor {
+public:
+  Sleeper() : in(*this) {}
+
+  void run() {
+    while (true) {
+      wait(in);
+      int ms = in.pop();
+      if (ms < 0)
+        return;
+      std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    }
+  }
+
+  void exit() { in.push(-1); }
+
+  Channel<int> in;
+};
+
+TEST_CASE("channel stall") {
+  Actor self;
+  self.set_name("self");
+  Channel<int> ints(self);
+  ints.set_name("ints");
+  Channel<StallEvent> stalls;
+  Watchdog watchdog(stalls, 20ms);
+
+  ints.push(1);
+  ints.push(2);
+  watchdog.check();
+  REQUIRE(!stalls.readable());
+
+  std::this_thread::sleep_for(30ms);
+  watchdog.check();
+  REQUIRE(stalls.readable());
+  StallEvent event = stalls.pop();
+  REQUIRE(event.kind == StallEvent::Kind::Channel);
+  REQUIRE(event.channel_name == "ints");
+  REQUIRE(event.channel_id == ints.stats().id);
+  REQUIRE(event.has_actor);
+  REQUIRE(event.actor_name == "self");
+  REQUIRE(event.age_ns >= 30000000);
+  REQUIRE(!stalls.readable());
+
+  // reported once
+  watchdog.check();
+  REQUIRE(!stalls.readable());
+
+  // the next element has been waiting just as long
+  ints.pop();
+  watchdog.check();
+  REQUIRE(stalls.readable());
+  REQUIRE(stalls.pop().channel_name == "ints");
+
+  ints.pop();
+  watchdog.check();
+  REQUIRE(!stalls.readable());
+  REQUIRE(ints.stats().head_age_ns == 0);
+}
+
+TEST_CASE("actor stall") {
+  Actor self;
+  Channel<StallEvent> stalls(self);
+  ActorThread<Sleeper> sleeper;
+  ActorThread<Watchdog> watchdog(stalls, 20ms, 5ms);
+
+  sleeper.in.push(0);
+  sleeper.in.push(100);
+
+  bool found = false;
+  while (!found && self.wait_for(1s, stalls) == 0) {
+    StallEvent event = stalls.pop();
+    if (event.kind == StallEvent::Kind::Actor &&
+        event.actor_name == "Sleeper") {
+      REQUIRE(event.actor_id == sleeper.stats().id);
+      REQUIRE(event.age_ns >= 20000000);
+      found = true;
+    }
+  }
+  REQUIRE(found);
+}